@@ -0,0 +1,164 @@
+//
+// Copyright (c) 2007 Sami Visnen
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+// Frame dump benchmark. Records a table scrolling session into a frame dump
+// and reports the encode and decode throughput and the compression ratio
+// against the raw frame buffers. No terminal is needed.
+//
+// usage: framedump [frames]
+
+#include <cli/widgets.h>
+#include <cli/framedump.h>
+#include <chrono>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+
+// rows for the table.
+std::vector<std::string> rows;
+
+class bench_data
+{
+public:
+protected:
+   ~bench_data() {}
+    typedef const std::string* value;
+
+    class converter {
+    public:
+        converter(const value& val, int col) : str_(val) {}
+        const char* str() const
+        {
+            return str_->c_str();
+        }
+        size_t len() const
+        {
+            return str_->size();
+        }
+    private:
+        const std::string* str_;
+    };
+
+    void fetch(value& val, int index) const
+    {
+        val = &rows[index];
+    }
+    int size() const
+    {
+        return static_cast<int>(rows.size());
+    }
+};
+
+double seconds(const std::chrono::steady_clock::time_point& start, const std::chrono::steady_clock::time_point& end)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / 1e9;
+}
+
+// scroll a table down a row at a time, a page now and then,
+// and record every frame.
+void bench_scroll(const cli::size& size, int frames, int keyframe_interval)
+{
+    cli::buffer fb;
+    fb.resize(size.rows, size.cols);
+    fb.clear();
+
+    cli::basic_table<bench_data> table;
+    table.addcol(size.cols / 2);
+    table.addcol(size.cols / 4);
+    table.addcol(size.cols / 4);
+    table.width(size.cols);
+    table.height(size.rows);
+    table.set_focus(true);
+
+    // render the session first so that only the encoding is measured.
+    std::vector<cli::buffer> session;
+    std::vector<cli::rect> dirty;
+    session.reserve(frames);
+    for (int i=0; i<frames; ++i)
+    {
+        table.keydown(0, i % 10 == 9 ? cli::VK_MOVE_DOWN_PAGE : cli::VK_MOVE_DOWN);
+        dirty.push_back(table.draw(fb));
+        session.push_back(fb);
+    }
+
+    std::ostringstream out;
+    const std::chrono::steady_clock::time_point encode_start = std::chrono::steady_clock::now();
+    {
+        cli::frame_writer writer(out, size.rows, size.cols, keyframe_interval);
+        for (int i=0; i<frames; ++i)
+            writer.write(session[i], dirty[i]);
+    }
+    const std::chrono::steady_clock::time_point encode_end = std::chrono::steady_clock::now();
+
+    const std::string dump = out.str();
+    std::istringstream in(dump);
+    const std::chrono::steady_clock::time_point decode_start = std::chrono::steady_clock::now();
+    {
+        cli::frame_reader reader(in);
+        cli::buffer buff;
+        int decoded = 0;
+        while (reader.next(buff))
+            ++decoded;
+        if (decoded != frames)
+            std::printf("decoded %d frames out of %d\n", decoded, frames);
+    }
+    const std::chrono::steady_clock::time_point decode_end = std::chrono::steady_clock::now();
+
+    const double raw = double(size.rows) * size.cols * sizeof(cli::cell) * frames;
+    const double encode = seconds(encode_start, encode_end);
+    const double decode = seconds(decode_start, decode_end);
+    std::printf("%4dx%-4d %8d %12.0f %12.0f %10.1f %10.1f %10.1f %8.1f\n", size.cols, size.rows, keyframe_interval,
+        raw, double(dump.size()), raw / dump.size(), 
+        encode ? raw / encode / 1e6 : 0, 
+        decode ? raw / decode / 1e6 : 0, 
+        double(dump.size()) / frames);
+}
+
+int main(int argc, char* argv[])
+{
+    const int frames = argc > 1 ? std::atoi(argv[1]) : 500;
+    for (int i=0; i<20000; ++i)
+    {
+        char buff[128];
+        std::snprintf(buff, sizeof(buff), "row %d lorem ipsum dolor sit amet consectetur adipiscing elit sed do", i);
+        rows.push_back(buff);
+    }
+
+    const cli::size sizes[] = {
+        {{80},  {25}},
+        {{200}, {60}},
+        {{400}, {120}}
+    };
+    const int intervals[] = {0, 100};
+
+    std::printf("frames: %d\n", frames);
+    std::printf("%-9s %8s %12s %12s %10s %10s %10s %8s\n", "size", "keyint", "raw bytes", "dump bytes", "ratio", "enc MB/s", "dec MB/s", "B/frame");
+    for (size_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); ++s)
+        for (size_t k=0; k<sizeof(intervals)/sizeof(intervals[0]); ++k)
+            bench_scroll(sizes[s], frames, intervals[k]);
+    return 0;
+}
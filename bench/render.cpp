@@ -0,0 +1,266 @@
+//
+// Copyright (c) 2007 Sami Visnen
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+// Headless render benchmark. Every widget type is drawn into an off-screen
+// frame buffer at a few different sizes and the time and the number of 
+// heap allocations per frame are reported. No terminal is needed.
+//
+// usage: render [frames] [widget name filter]
+
+#include <cli/widgets.h>
+#include <cli/instrument.h>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// count every heap allocation done by the benchmark process.
+CLI_INSTRUMENT_ALLOCATIONS()
+
+// rows for the list, table and view widgets.
+std::vector<std::string> rows;
+
+class bench_data
+{
+public:
+protected:
+   ~bench_data() {}
+    typedef const std::string* value;
+
+    class converter {
+    public:
+        converter(const value& val) : str_(val) {}
+        converter(const value& val, int col) : str_(val) {}
+        const char* str() const
+        {
+            return str_->c_str();
+        }
+        size_t len() const
+        {
+            return str_->size();
+        }
+    private:
+        const std::string* str_;
+    };
+
+    void fetch(value& val, int index) const
+    {
+        val = &rows[index];
+    }
+    int size() const
+    {
+        return static_cast<int>(rows.size());
+    }
+};
+
+struct result {
+    double ns_per_frame;
+    double cells_per_sec;
+    double allocs_per_frame;
+    double bytes_per_frame;
+};
+
+// draw the widget the given number of times and measure.
+result measure(cli::widget& w, cli::buffer& fb, int frames)
+{
+    // warm up so that any lazily grown buffers are in place.
+    w.invalidate(true);
+    w.draw(fb);
+
+    unsigned long long cells = 0;
+    const cli::alloc_stats before = cli::alloc_counters();
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i=0; i<frames; ++i)
+    {
+        w.invalidate(true);
+        const cli::rect rc = w.draw(fb);
+        w.validate();
+        cells += (rc.right - rc.left) * (rc.bottom - rc.top);
+    }
+    const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    const cli::alloc_stats allocs = cli::alloc_counters() - before;
+    const double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+
+    result ret;
+    ret.ns_per_frame     = ns / frames;
+    ret.cells_per_sec    = ns ? cells / (ns / 1e9) : 0;
+    ret.allocs_per_frame = double(allocs.allocs) / frames;
+    ret.bytes_per_frame  = double(allocs.bytes) / frames;
+    return ret;
+}
+
+void report(const char* name, const cli::size& size, const result& r)
+{
+    std::printf("%-12s %4dx%-4d %12.0f %14.0f %10.2f %12.1f\n", name, size.cols, size.rows,
+        r.ns_per_frame, r.cells_per_sec, r.allocs_per_frame, r.bytes_per_frame);
+}
+
+void bench_list(const cli::size& size, int frames)
+{
+    cli::buffer fb;
+    fb.resize(size.rows, size.cols);
+    cli::basic_list<bench_data> list;
+    list.width(size.cols);
+    list.height(size.rows);
+    list.set_focus(true);
+    list.selpos(size.rows / 2);
+    report("list", size, measure(list, fb, frames));
+}
+
+void bench_table(const cli::size& size, int frames)
+{
+    cli::buffer fb;
+    fb.resize(size.rows, size.cols);
+    cli::basic_table<bench_data> table;
+    table.addcol(size.cols / 2);
+    table.addcol(size.cols / 4);
+    table.addcol(size.cols / 4 - 4);
+    table.cellspacing(1);
+    table.width(size.cols);
+    table.height(size.rows);
+    table.set_focus(true);
+    report("table", size, measure(table, fb, frames));
+}
+
+void bench_view(const cli::size& size, int frames)
+{
+    cli::buffer fb;
+    fb.resize(size.rows, size.cols);
+    cli::basic_view<bench_data> view;
+    view.width(size.cols);
+    view.height(size.rows);
+    report("view", size, measure(view, fb, frames));
+}
+
+void bench_input(const cli::size& size, int frames)
+{
+    cli::buffer fb;
+    fb.resize(1, size.cols);
+    cli::basic_input<> input;
+    input.width(size.cols);
+    input.value(std::string(size.cols * 2, 'x'));
+    input.set_focus(true);
+    report("input", size, measure(input, fb, frames));
+}
+
+void bench_menu(const cli::size& size, int frames)
+{
+    cli::buffer fb;
+    fb.resize(size.rows, size.cols);
+    cli::menulist list(4);
+    for (int i=0; i<4; ++i)
+    {
+        list[i].text = "Menu";
+        for (int x=0; x<size.rows - 4; ++x)
+            list[i].items.push_back(cli::make_menu_item("Menu item", x));
+    }
+    cli::menu menu;
+    menu.setmenu(list);
+    menu.open(0);
+    report("menu", size, measure(menu, fb, frames));
+}
+
+void bench_progressbar(const cli::size& size, int frames)
+{
+    cli::buffer fb;
+    fb.resize(1, size.cols);
+    cli::progressbar bar;
+    bar.width(size.cols);
+    bar.setrange(0, 100);
+    bar.setpos(42);
+    bar.settext("42%");
+    report("progressbar", size, measure(bar, fb, frames));
+}
+
+void bench_text(const cli::size& size, int frames)
+{
+    cli::buffer fb;
+    fb.resize(1, size.cols);
+    cli::text text;
+    text.width(size.cols);
+    text.settext(std::string(size.cols, 't'));
+    report("text", size, measure(text, fb, frames));
+}
+
+void bench_checkbox(const cli::size& size, int frames)
+{
+    cli::buffer fb;
+    fb.resize(1, size.cols);
+    cli::checkbox check;
+    check.text("checkbox");
+    report("checkbox", size, measure(check, fb, frames));
+}
+
+struct benchmark {
+    const char* name;
+    void (*run)(const cli::size&, int);
+};
+
+int main(int argc, char* argv[])
+{
+    const int frames = argc > 1 ? std::atoi(argv[1]) : 1000;
+    const char* filter = argc > 2 ? argv[2] : "";
+    if (frames <= 0)
+    {
+        std::fprintf(stderr, "usage: render [frames] [widget name filter]\n");
+        return 1;
+    }
+
+    const benchmark benchmarks[] = {
+        {"list",        bench_list},
+        {"table",       bench_table},
+        {"view",        bench_view},
+        {"input",       bench_input},
+        {"menu",        bench_menu},
+        {"progressbar", bench_progressbar},
+        {"text",        bench_text},
+        {"checkbox",    bench_checkbox}
+    };
+    const cli::size sizes[] = {
+        {{80},  {25}},
+        {{200}, {60}},
+        {{400}, {120}}
+    };
+
+    for (int i=0; i<1000; ++i)
+    {
+        char buff[64];
+        std::snprintf(buff, sizeof(buff), "row %d lorem ipsum dolor sit amet consectetur adipiscing", i);
+        rows.push_back(buff);
+    }
+
+    std::printf("%-12s %9s %12s %14s %10s %12s\n", "widget", "size", "ns/frame", "cells/s", "allocs", "bytes");
+    for (std::size_t b=0; b<sizeof(benchmarks)/sizeof(benchmarks[0]); ++b)
+    {
+        if (std::strstr(benchmarks[b].name, filter) == NULL)
+            continue;
+        for (std::size_t s=0; s<sizeof(sizes)/sizeof(sizes[0]); ++s)
+            benchmarks[b].run(sizes[s], frames);
+    }
+    return 0;
+}
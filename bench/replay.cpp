@@ -0,0 +1,276 @@
+//
+// Copyright (c) 2007 Sami Visnen
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+// Session record and replay tool. 
+//
+// replay record <file>  runs a demo application in the terminal and records 
+//                       the session into the file.
+// replay play <file>    replays the recorded session headless as fast as possible
+//                       and reports the frame times and the output sizes.
+//
+// Since the replay has to rebuild the same user interface that the session
+// was recorded with, both modes use the same demo application. Applications
+// that want to replay their own sessions use cli::session_replay in the same way.
+
+#include <cli/widgets.h>
+#include <cli/terminal.h>
+#include <cli/session.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdio>
+
+enum { VK_EXIT_APPLICATION = cli::VK_SENTINEL + 1 };
+
+std::vector<std::string> rows;
+
+class demo_data
+{
+public:
+protected:
+   ~demo_data() {}
+    typedef const std::string* value;
+
+    class converter {
+    public:
+        converter(const value& val) : str_(val) {}
+        const char* str() const
+        {
+            return str_->c_str();
+        }
+        size_t len() const
+        {
+            return str_->size();
+        }
+    private:
+        const std::string* str_;
+    };
+
+    void fetch(value& val, int index) const
+    {
+        val = &rows[index];
+    }
+    int size() const
+    {
+        return static_cast<int>(rows.size());
+    }
+};
+
+typedef cli::basic_list<demo_data, cli::default_single_selection, cli::right_to_left_ticker> demo_list;
+
+// the demo user interface.
+struct demo
+{
+    cli::window wnd;
+    cli::text   header;
+    demo_list   list;
+    cli::basic_input<> input;
+    cli::text   footer;
+
+    demo(const cli::size& size)
+    {
+        header.position(0, 0);
+        header.width(size.cols);
+        header.settext("replay demo - tab to change focus, q to quit");
+        header.setattrib(cli::ATTRIB_UNDERLINE | cli::ATTRIB_BOLD);
+
+        list.position(0, 2);
+        list.width(size.cols);
+        list.height(size.rows - 6);
+
+        input.position(0, size.rows - 3);
+        input.width(size.cols);
+
+        footer.position(0, size.rows - 1);
+        footer.width(size.cols);
+        footer.settext("Recording...");
+
+        wnd.add(&header);
+        wnd.add(&list);
+        wnd.add(&input);
+        wnd.add(&footer);
+        wnd.show();
+    }
+};
+
+int map_input(int ch)
+{
+    switch (ch)
+    {
+        case cli::TERM_MOVE_DOWN:      return cli::VK_MOVE_DOWN;
+        case cli::TERM_MOVE_UP:        return cli::VK_MOVE_UP;
+        case cli::TERM_MOVE_HOME:      return cli::VK_MOVE_HOME;
+        case cli::TERM_MOVE_END:       return cli::VK_MOVE_END;
+        case cli::TERM_MOVE_DOWN_PAGE: return cli::VK_MOVE_DOWN_PAGE;
+        case cli::TERM_MOVE_UP_PAGE:   return cli::VK_MOVE_UP_PAGE;
+        case cli::TERM_MOVE_PREV:      return cli::VK_MOVE_PREV;
+        case cli::TERM_MOVE_NEXT:      return cli::VK_MOVE_NEXT;
+        case '\t':                     return cli::VK_FOCUS_NEXT;
+        case '\n':                     return cli::VK_ACTION_ENTER;
+        case 127:
+        case '\b':                     return cli::VK_ERASE;
+        case 'q':                      return VK_EXIT_APPLICATION;
+    }
+    return -1;
+}
+
+void draw_window(cli::window* wnd, cli::buffer* fb, cli::session_writer* session)
+{
+    const cli::rect dirty = wnd->draw(*fb);
+    const int bytes = cli::term_draw_buffer(*fb, dirty);
+    wnd->record_output(bytes);
+    session->frame(dirty, bytes);
+}
+
+int record(const char* file)
+{
+    std::ofstream out(file, std::ios::binary);
+    if (!out.is_open())
+    {
+        std::cerr << "failed to open " << file << std::endl;
+        return 1;
+    }
+    cli::term_init();
+    cli::term_init_colors();
+    cli::term_enable_paste(true);
+
+    const cli::size size = cli::term_get_size();
+    cli::buffer fb;
+    fb.resize(size.rows, size.cols);
+
+    cli::session_writer session(out, size);
+    demo app(size);
+    app.wnd.evtdraw = std::bind(draw_window, std::placeholders::_1, &fb, &session);
+    app.wnd.invalidate();
+
+    std::chrono::steady_clock::time_point frame_time = std::chrono::steady_clock::now();
+    while (true)
+    {
+        const int wait = app.wnd.next_frame();
+        const int ch = wait == -1 ? cli::term_get_key() : cli::term_wait_key(wait);
+
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        const int elapsed = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(now - frame_time).count());
+        frame_time = now;
+        const cli::rect animated = app.wnd.animate(fb, elapsed);
+        if (!cli::rect_is_empty(animated))
+            session.frame(animated, cli::term_draw_buffer(fb, animated));
+        if (ch == -1)
+            continue;
+        if (ch == cli::TERM_PASTE)
+        {
+            const std::string& text = cli::term_paste_text();
+            session.paste(text);
+            app.wnd.paste(text.data(), text.size());
+            continue;
+        }
+
+        const int vk = map_input(ch);
+        if (vk == VK_EXIT_APPLICATION)
+            break;
+        session.key(ch, vk);
+        app.wnd.keydown(ch, vk);
+    }
+    cli::term_uninit();
+    return 0;
+}
+
+int percentile(std::vector<int>& values, double p)
+{
+    if (values.empty())
+        return 0;
+    const std::size_t n = static_cast<std::size_t>(p * (values.size() - 1) + 0.5);
+    std::nth_element(values.begin(), values.begin() + n, values.end());
+    return values[n];
+}
+
+int play(const char* file)
+{
+    std::ifstream in(file, std::ios::binary);
+    if (!in.is_open())
+    {
+        std::cerr << "failed to open " << file << std::endl;
+        return 1;
+    }
+    cli::session_reader session(in);
+
+    cli::buffer fb;
+    fb.resize(session.screen().rows, session.screen().cols);
+
+    demo app(session.screen());
+    app.wnd.invalidate();
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    cli::replay_report report = cli::session_replay(session, app.wnd, fb);
+    const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    std::printf("screen          %dx%d\n", session.screen().cols, session.screen().rows);
+    std::printf("keys            %d\n", report.keys);
+    std::printf("pastes          %d\n", report.pastes);
+    std::printf("frames          %d (recorded %d)\n", report.frames, report.recorded_frames);
+    std::printf("mismatches      %d\n", report.mismatches);
+    std::printf("recorded bytes  %lld\n", report.recorded_bytes);
+    std::printf("replayed cells  %lld\n", report.replayed_cells);
+    std::printf("total time      %lld us\n", (long long)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+    std::printf("frame time p50  %d us\n", percentile(report.frame_us, 0.5));
+    std::printf("frame time p90  %d us\n", percentile(report.frame_us, 0.9));
+    std::printf("frame time p99  %d us\n", percentile(report.frame_us, 0.99));
+    std::printf("frame time max  %d us\n", percentile(report.frame_us, 1.0));
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3)
+    {
+        std::cerr << "usage: replay record|play <file>" << std::endl;
+        return 1;
+    }
+    for (int i=0; i<5000; ++i)
+    {
+        char buff[64];
+        std::snprintf(buff, sizeof(buff), "row %d lorem ipsum dolor sit amet consectetur adipiscing elit", i);
+        rows.push_back(buff);
+    }
+    try
+    {
+        const std::string mode = argv[1];
+        if (mode == "record")
+            return record(argv[2]);
+        else if (mode == "play")
+            return play(argv[2]);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::cerr << "usage: replay record|play <file>" << std::endl;
+    return 1;
+}
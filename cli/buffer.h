@@ -77,7 +77,7 @@ namespace cli
         }
         void clear()
         {
-            const cell c = {' ', ATTRIB_NONE, COLOR_NONE};
+            const cell c = {' ', ATTRIB_NONE, COLOR_NONE, 0, 0};
             for (size_t row=0; row<rows(); ++row)
             {
                 buffer::row_type& r = rows_[row];
@@ -88,7 +88,7 @@ namespace cli
 
         void clear(const rect& rc)
         {
-            const cell c = {' ', ATTRIB_NONE, COLOR_NONE};
+            const cell c = {' ', ATTRIB_NONE, COLOR_NONE, 0, 0};
             for (size_t row=rc.top; row<rc.bottom; ++row)
             {
                 buffer::row_type& r = rows_[row];
@@ -65,7 +65,7 @@ namespace cli
         rect draw(buffer& fb)
         {
             const color col = focus_ ? COLOR_SELECTION : COLOR_NONE;
-            const cell c = {0, ATTRIB_NONE, (short)col};
+            const cell c = {0, ATTRIB_NONE, (short)col, 0, 0};
             formatter f(c, fb);
             f.move(xpos_, ypos_);
             f.print(text_.c_str(), text_.size());
@@ -53,7 +53,7 @@ namespace cli
         }
         rect draw(buffer& fb)
         {
-            const cell c = {0, ATTRIB_NONE, COLOR_NONE};
+            const cell c = {0, ATTRIB_NONE, COLOR_NONE, 0, 0};
             const color col = focus_ ? COLOR_SELECTION : COLOR_NONE;
 
             formatter f(c, fb);
@@ -61,14 +61,14 @@ namespace cli
             f.print(text_.c_str(), text_.size());
             if (checked_)
             {
-                const cell c = {0, (short)ATTRIB_NONE, (short)col};
+                const cell c = {0, (short)ATTRIB_NONE, (short)col, 0, 0};
                 formatter f(c, fb);
                 f.move(xpos_ + text_.size(), ypos_);
                 f.print("[*]", 3);
             }
             else
             {
-                const cell c = {0, (short)ATTRIB_NONE, (short)col};
+                const cell c = {0, (short)ATTRIB_NONE, (short)col, 0, 0};
                 formatter f(c, fb);
                 f.move(xpos_ + text_.size(), ypos_);
                 f.print("[ ]", 3);
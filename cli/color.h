@@ -0,0 +1,304 @@
+//
+// Copyright (c) 2007 Sami Visnen
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+#include "config.h"
+
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cassert>
+
+namespace cli
+{
+    // Extended colors. Besides the semantic color a cell can carry an explicit
+    // foreground and background color, either an index into the 256 color 
+    // xterm palette or a 24 bit RGB value. The value 0 means no extended color.
+    // An extended color overrides the semantic color of the cell.
+
+    enum {
+        COLOR_EXT_NONE  = 0,
+        COLOR_EXT_INDEX = 0x01000000,
+        COLOR_EXT_RGB   = 0x02000000
+    };
+
+    // Make an extended color from a 256 color palette index.
+    inline
+    unsigned color_index(int index)
+    {
+        assert(index >= 0 && index < 256);
+        return COLOR_EXT_INDEX | index;
+    }
+
+    // Make an extended color from 8 bit red, green and blue components.
+    inline
+    unsigned color_rgb(int r, int g, int b)
+    {
+        return COLOR_EXT_RGB | (r & 0xff) << 16 | (g & 0xff) << 8 | (b & 0xff);
+    }
+
+    inline
+    bool is_color_index(unsigned color)
+    {
+        return (color & 0xff000000) == COLOR_EXT_INDEX;
+    }
+
+    inline
+    bool is_color_rgb(unsigned color)
+    {
+        return (color & 0xff000000) == COLOR_EXT_RGB;
+    }
+
+    namespace detail {
+        // map a color component to the nearest level of the 6x6x6 color cube.
+        inline
+        int cube_level(int c)
+        {
+            return c < 48 ? 0 : c < 115 ? 1 : (c - 35) / 40;
+        }
+        inline
+        int cube_value(int level)
+        {
+            return level ? 55 + level * 40 : 0;
+        }
+        inline
+        int distance(int r1, int g1, int b1, int r2, int g2, int b2)
+        {
+            return (r1 - r2) * (r1 - r2) + (g1 - g2) * (g1 - g2) + (b1 - b2) * (b1 - b2);
+        }
+    } // detail
+
+    // Map an extended color to the nearest color of the 256 color xterm palette.
+    // Returns -1 for COLOR_EXT_NONE.
+    inline
+    int color_to_xterm256(unsigned color)
+    {
+        if (is_color_index(color))
+            return color & 0xff;
+        if (!is_color_rgb(color))
+            return -1;
+
+        const int r = (color >> 16) & 0xff;
+        const int g = (color >> 8) & 0xff;
+        const int b = color & 0xff;
+
+        // pick the closer one of the color cube and the gray ramp.
+        const int cr = detail::cube_level(r);
+        const int cg = detail::cube_level(g);
+        const int cb = detail::cube_level(b);
+        const int cube = 16 + 36 * cr + 6 * cg + cb;
+        const int cube_dist = detail::distance(r, g, b, 
+            detail::cube_value(cr), detail::cube_value(cg), detail::cube_value(cb));
+
+        const int avg  = (r + g + b) / 3;
+        const int gray = avg > 238 ? 23 : (avg < 8 ? 0 : (avg - 3) / 10);
+        const int gv   = 8 + gray * 10;
+        const int gray_dist = detail::distance(r, g, b, gv, gv, gv);
+
+        return gray_dist < cube_dist ? 232 + gray : cube;
+    }
+
+    // Map a 256 color palette index to the nearest of the 16 basic colors
+    // where bit 0 is red, bit 1 green, bit 2 blue and bit 3 intensity.
+    inline
+    int xterm256_to_ansi16(int index)
+    {
+        if (index < 16)
+            return index;
+        int r, g, b;
+        if (index >= 232)
+        {
+            r = g = b = 8 + (index - 232) * 10;
+        }
+        else
+        {
+            index -= 16;
+            r = detail::cube_value(index / 36);
+            g = detail::cube_value(index / 6 % 6);
+            b = detail::cube_value(index % 6);
+        }
+        const int max = std::max(r, std::max(g, b));
+        if (max < 64)
+            return 0;
+        const int bits = (r > max / 2 ? 1 : 0) | (g > max / 2 ? 2 : 0) | (b > max / 2 ? 4 : 0);
+        return max > 191 ? bits | 8 : bits;
+    }
+
+    // Color_pair_cache maps foreground and background color combinations to
+    // a limited number of terminal color pairs such as ncurses pairs. When all
+    // the pairs are assigned the least recently used pair that no cell on the
+    // screen uses is reassigned, since reinitializing a pair recolors every 
+    // cell drawn with it. The caller counts the cells with retain and release.
+    // Only when every pair is on the screen the least recently used pair is 
+    // reassigned regardless. The lookup of a cached pair does not allocate.
+    class color_pair_cache
+    {
+    public:
+        // Manage the pairs [first, first + count).
+        color_pair_cache(int first, int count) : first_(first), used_(0), head_(-1), tail_(-1), evictions_(0)
+        {
+            assert(count > 0);
+            nodes_.resize(count);
+            map_.reserve(count);
+        }
+
+        // Get the pair for the colors. Fg and bg are terminal color numbers,
+        // -1 is the terminal default. Returns true if the pair was newly 
+        // assigned and has to be (re)initialized with the colors.
+        bool lookup(int fg, int bg, int& pair)
+        {
+            const unsigned key = static_cast<unsigned>(fg + 1) << 16 | static_cast<unsigned>(bg + 1);
+            std::unordered_map<unsigned, int>::const_iterator it = map_.find(key);
+            if (it != map_.end())
+            {
+                touch(it->second);
+                pair = first_ + it->second;
+                return false;
+            }
+            int index = 0;
+            if (used_ < static_cast<int>(nodes_.size()))
+            {
+                index = used_++;
+                nodes_[index].uses = 0;
+            }
+            else
+            {
+                // reuse the least recently used pair not on the screen.
+                index = tail_;
+                while (index != -1 && nodes_[index].uses)
+                    index = nodes_[index].prev;
+                // every pair is on the screen, the cells keep counting
+                // against the pair as they are now shown in its new colors.
+                if (index == -1)
+                    index = tail_;
+                unlink(index);
+                map_.erase(nodes_[index].key);
+                ++evictions_;
+            }
+            nodes_[index].key = key;
+            map_.insert(std::make_pair(key, index));
+            push_front(index);
+            pair = first_ + index;
+            return true;
+        }
+
+        // Count a cell on the screen drawn with the pair. 
+        // Pairs outside of the managed range are ignored.
+        void retain(int pair)
+        {
+            if (pair >= first_ && pair < first_ + used_)
+                ++nodes_[pair - first_].uses;
+        }
+
+        // Count a cell drawn with the pair being overwritten.
+        void release(int pair)
+        {
+            if (pair >= first_ && pair < first_ + used_ && nodes_[pair - first_].uses)
+                --nodes_[pair - first_].uses;
+        }
+
+        // Get the number of cells on the screen drawn with the pair.
+        int uses(int pair) const
+        {
+            if (pair >= first_ && pair < first_ + used_)
+                return nodes_[pair - first_].uses;
+            return 0;
+        }
+
+        // Forget the cells on the screen, for example when the screen is cleared.
+        void release_all()
+        {
+            for (int i=0; i<used_; ++i)
+                nodes_[i].uses = 0;
+        }
+
+        // Forget all the pairs.
+        void clear()
+        {
+            map_.clear();
+            used_ = 0;
+            head_ = tail_ = -1;
+        }
+
+        // Get the number of pairs in use.
+        int size() const
+        {
+            return used_;
+        }
+        int capacity() const
+        {
+            return static_cast<int>(nodes_.size());
+        }
+
+        // Get the number of times a pair has been reassigned.
+        int evictions() const
+        {
+            return evictions_;
+        }
+    private:
+        struct node {
+            unsigned key;
+            int uses;
+            int prev;
+            int next;
+        };
+        void unlink(int index)
+        {
+            node& n = nodes_[index];
+            if (n.prev != -1) nodes_[n.prev].next = n.next;
+            else head_ = n.next;
+            if (n.next != -1) nodes_[n.next].prev = n.prev;
+            else tail_ = n.prev;
+        }
+        void push_front(int index)
+        {
+            node& n = nodes_[index];
+            n.prev = -1;
+            n.next = head_;
+            if (head_ != -1)
+                nodes_[head_].prev = index;
+            head_ = index;
+            if (tail_ == -1)
+                tail_ = index;
+        }
+        void touch(int index)
+        {
+            if (index == head_)
+                return;
+            unlink(index);
+            push_front(index);
+        }
+
+        std::vector<node> nodes_;
+        std::unordered_map<unsigned, int> map_;
+        int first_;
+        int used_;
+        int head_;
+        int tail_;
+        int evictions_;
+    };
+
+} // cli
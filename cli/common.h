@@ -90,13 +90,19 @@ struct cell
     int   value; 
     short attrib;
     short color;
+    unsigned fg;  // Extended foreground color, see color.h. 0 for none.
+    unsigned bg;  // Extended background color, see color.h. 0 for none.
 };
 
+// Value of the cell covered by the right half of a double width
+// character. The backends do not output anything for these cells.
+enum { CELL_WIDE_TAIL = -1 };
+
 // Make cell object from value v, attrib a and color c.
 inline
 cell make_cell(int v, short a, short c)
 {
-    cell cl = {v, a, c};
+    cell cl = {v, a, c, 0, 0};
     return cl;
 }
 
@@ -105,7 +111,9 @@ bool operator==(const cell& lhs, const cell& rhs)
 {
     return lhs.value == rhs.value &&
       lhs.attrib == rhs.attrib &&
-      lhs.color == rhs.color;
+      lhs.color == rhs.color &&
+      lhs.fg == rhs.fg &&
+      lhs.bg == rhs.bg;
 }
 
 // Cursor represents an "abstract cursor". Widgets update the cursor 
@@ -128,6 +136,14 @@ struct rect
     int bottom;  // bottom right
 };
 
+// Make rect from a position and a size.
+inline
+rect make_rect(int x, int y, int width, int height)
+{
+    rect rc = {y, x, x + width, y + height};
+    return rc;
+}
+
 inline
 rect rect_union(const rect& lhs, const rect& rhs)
 {
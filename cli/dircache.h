@@ -0,0 +1,439 @@
+//
+// Copyright (c) 2007 Sami Visnen
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "config.h"
+
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/algorithm/string/replace.hpp>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+
+#if defined(__linux__)
+#  include <sys/inotify.h>
+#  include <unistd.h>
+#endif
+
+namespace cli
+{
+    // Directory_cache reads directory listings on a background thread and
+    // caches them per directory. Fetching a listing never blocks, if the
+    // directory is not cached yet it is queued for reading and the caller
+    // polls again later.
+    //
+    // On linux every cached directory is watched with inotify and the
+    // listing is dropped as soon as entries are created, deleted or renamed
+    // in the directory. The events are processed whenever the cache is
+    // accessed. A directory that changes while it is being read is read 
+    // again, up to MAX_REREADS times. A directory that keeps changing gets
+    // the last listing delivered once and is reread on the following fetch.
+    // Elsewhere call invalidate() to force a directory to be reread.
+    //
+    // The cache holds a limited number of listings. When it is full the 
+    // least recently fetched listing is dropped along with its watch.
+    class directory_cache
+    {
+    public:
+        struct entry {
+            std::string path;  // native path including the directory
+            bool folder;
+            bool hidden;
+        };
+        // Entries sorted by path.
+        typedef std::vector<entry> listing;
+
+        directory_cache() : capacity_(64), clock_(0), reading_(-1), changed_(false), stop_(false), inotify_(-1)
+        {
+#if defined(__linux__)
+            inotify_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+        }
+       ~directory_cache()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stop_ = true;
+            }
+            wake_.notify_one();
+            if (thread_.joinable())
+                thread_.join();
+#if defined(__linux__)
+            if (inotify_ != -1)
+                close(inotify_);
+#endif
+        }
+
+        // Get the listing of the directory. Returns true if the listing is
+        // available. Otherwise the directory is queued for reading and
+        // false is returned. A directory that cannot be read gives an
+        // empty listing once and is retried on the next fetch.
+        bool fetch(const std::string& dir, std::shared_ptr<const listing>& out)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            process_events();
+            if (take(dir, out))
+                return true;
+            request(dir);
+            return false;
+        }
+
+        // Block until the listing of the directory has been read.
+        std::shared_ptr<const listing> wait(const std::string& dir)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            process_events();
+            std::shared_ptr<const listing> out;
+            while (!take(dir, out))
+            {
+                request(dir);
+                done_.wait(lock);
+            }
+            return out;
+        }
+
+        // Check whether the listing of the directory is cached.
+        bool is_cached(const std::string& dir)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            process_events();
+            cache_map::const_iterator it = cache_.find(dir);
+            return it != cache_.end() && !it->second.stale;
+        }
+
+        // Drop the listing of the directory. It is reread on the next fetch.
+        void invalidate(const std::string& dir)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            cache_map::iterator it = cache_.find(dir);
+            if (it != cache_.end())
+                drop(it);
+        }
+
+        // Drop all listings.
+        void clear()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            while (!cache_.empty())
+                drop(cache_.begin());
+        }
+
+        // Set the maximum number of cached listings.
+        void set_capacity(std::size_t capacity)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            capacity_ = std::max<std::size_t>(capacity, 1);
+            while (cache_.size() > capacity_)
+                evict();
+        }
+
+        // Get the number of cached listings.
+        std::size_t size()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return cache_.size();
+        }
+
+        // Get the number of directories watched for changes.
+        std::size_t watches()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return watches_.size();
+        }
+    private:
+        struct cached {
+            std::shared_ptr<const listing> list;
+            unsigned long long used;  // clock_ when last fetched
+            int wd;                   // inotify watch or -1
+            bool stale;               // changed during the read, fetched once
+        };
+
+        enum { MAX_REREADS = 2 };
+        typedef std::map<std::string, cached> cache_map;
+
+        // called with the mutex held.
+        bool take(const std::string& dir, std::shared_ptr<const listing>& out)
+        {
+            cache_map::iterator it = cache_.find(dir);
+            if (it != cache_.end())
+            {
+                it->second.used = ++clock_;
+                out = it->second.list;
+                if (it->second.stale)
+                    drop(it);
+                return true;
+            }
+            std::map<std::string, std::shared_ptr<const listing> >::iterator failed = failed_.find(dir);
+            if (failed != failed_.end())
+            {
+                out = failed->second;
+                failed_.erase(failed);
+                return true;
+            }
+            return false;
+        }
+
+        // drop a listing and stop watching the directory.
+        // called with the mutex held.
+        void drop(cache_map::iterator it)
+        {
+            const int wd = it->second.wd;
+            cache_.erase(it);
+            unwatch(wd);
+        }
+
+        // drop the least recently fetched listing.
+        // called with the mutex held.
+        void evict()
+        {
+            cache_map::iterator lru = cache_.begin();
+            for (cache_map::iterator it = cache_.begin(); it != cache_.end(); ++it)
+            {
+                if (it->second.used < lru->second.used)
+                    lru = it;
+            }
+            if (lru != cache_.end())
+                drop(lru);
+        }
+
+        // remove the watch unless the directory is being read or is 
+        // cached under another name. called with the mutex held.
+        void unwatch(int wd)
+        {
+#if defined(__linux__)
+            if (wd == -1 || wd == reading_)
+                return;
+            for (cache_map::const_iterator it = cache_.begin(); it != cache_.end(); ++it)
+            {
+                if (it->second.wd == wd)
+                    return;
+            }
+            inotify_rm_watch(inotify_, wd);
+            watches_.erase(wd);
+#endif
+        }
+
+        // called with the mutex held.
+        void request(const std::string& dir)
+        {
+            if (!pending_.insert(dir).second)
+                return;
+            queue_.push_back(dir);
+            if (!thread_.joinable())
+                thread_ = std::thread(&directory_cache::run, this);
+            else wake_.notify_one();
+        }
+
+        // drop the listings of the directories that have changed.
+        // called with the mutex held.
+        void process_events()
+        {
+#if defined(__linux__)
+            if (inotify_ == -1)
+                return;
+            char buff[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+            for (;;)
+            {
+                const ssize_t len = read(inotify_, buff, sizeof(buff));
+                if (len <= 0)
+                    break;
+                for (const char* ptr = buff; ptr < buff + len; )
+                {
+                    const inotify_event* event = reinterpret_cast<const inotify_event*>(ptr);
+                    ptr += sizeof(inotify_event) + event->len;
+
+                    // events were lost, anything may have changed.
+                    if (event->mask & IN_Q_OVERFLOW)
+                    {
+                        changed_ = true;
+                        while (!cache_.empty())
+                            drop(cache_.begin());
+                        continue;
+                    }
+
+                    // the listing being read may have missed the change.
+                    if (event->wd == reading_)
+                        changed_ = true;
+
+                    // the directory is gone and so is the watch.
+                    const bool gone = (event->mask & IN_IGNORED) != 0;
+                    if (gone)
+                        watches_.erase(event->wd);
+                    for (cache_map::iterator it = cache_.begin(); it != cache_.end(); )
+                    {
+                        if (it->second.wd != event->wd)
+                        {
+                            ++it;
+                            continue;
+                        }
+                        if (gone)
+                            it->second.wd = -1;
+                        drop(it++);
+                    }
+                }
+            }
+#endif
+        }
+
+        void run()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            std::string rereading;
+            int rereads = 0;
+            for (;;)
+            {
+                while (queue_.empty() && !stop_)
+                    wake_.wait(lock);
+                if (stop_)
+                    return;
+
+                const std::string dir = queue_.front();
+                queue_.pop_front();
+                if (dir != rereading)
+                    rereads = 0;
+                int wd = -1;
+#if defined(__linux__)
+                // watch before reading so that no change can slip
+                // in between reading and watching.
+                if (inotify_ != -1)
+                {
+                    wd = inotify_add_watch(inotify_, dir.c_str(),
+                        IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF);
+                    if (wd != -1)
+                        watches_.insert(wd);
+                }
+#endif
+                reading_ = wd;
+                changed_ = false;
+                lock.unlock();
+                std::shared_ptr<listing> list(new listing);
+                const bool ok = read_directory(dir, *list);
+                lock.lock();
+
+                // the events that came in during the read still 
+                // have to be checked against this directory.
+                process_events();
+                reading_ = -1;
+                if (ok && changed_ && rereads < MAX_REREADS)
+                {
+                    // the listing may be stale. read it again.
+                    rereading = dir;
+                    ++rereads;
+                    queue_.push_front(dir);
+                    continue;
+                }
+                rereading.clear();
+                if (wd != -1 && watches_.find(wd) == watches_.end())
+                    wd = -1;
+                pending_.erase(dir);
+                if (ok)
+                {
+                    // a directory that keeps changing is handed
+                    // out once and read again on the next fetch.
+                    const cached c = {list, ++clock_, wd, changed_};
+                    cache_[dir] = c;
+                    while (cache_.size() > capacity_)
+                        evict();
+                }
+                else
+                {
+                    unwatch(wd);
+                    failed_[dir] = list;
+                }
+                done_.notify_all();
+            }
+        }
+
+        static bool read_directory(const std::string& dir, listing& list)
+        {
+            using namespace boost::filesystem;
+
+            try
+            {
+                directory_iterator end;
+                for (directory_iterator it((path(dir))); it != end; ++it)
+                {
+                    const path& p = it->path();
+                    const std::string leaf = p.filename().string();
+
+                    entry e;
+                    e.path   = p.string();
+                    e.hidden = !leaf.empty() && leaf[0] == '.';
+#ifdef WINDOWS
+                    boost::replace_first(e.path, "\\\\", "\\");
+#endif
+                    boost::system::error_code err;
+                    // the file type usually comes with the directory entry
+                    // so this does not need to stat every file.
+                    e.folder = is_directory(it->status(err));
+                    if (err)
+                        continue;
+                    list.push_back(e);
+                }
+            }
+            catch (const std::exception&)
+            {
+                list.clear();
+                return false;
+            }
+            std::sort(list.begin(), list.end(), entry_less());
+            return true;
+        }
+
+        struct entry_less {
+            bool operator()(const entry& lhs, const entry& rhs) const
+            {
+                return lhs.path < rhs.path;
+            }
+        };
+
+        std::mutex mutex_;
+        std::condition_variable wake_;
+        std::condition_variable done_;
+        cache_map cache_;
+        std::map<std::string, std::shared_ptr<const listing> > failed_;
+        std::set<int> watches_;
+        std::deque<std::string> queue_;
+        std::set<std::string> pending_;
+        std::size_t capacity_;
+        unsigned long long clock_;
+        int  reading_;          // watch of the directory being read
+        bool changed_;          // the directory changed during the read
+        std::thread thread_;
+        bool stop_;
+        int inotify_;
+    };
+
+} // cli
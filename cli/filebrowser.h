@@ -27,13 +27,12 @@
 
 #include "config.h"
 
-#include <boost/filesystem/path.hpp>
-#include <boost/filesystem/operations.hpp>
-#include <boost/filesystem/convenience.hpp>
-#include <boost/algorithm/string/replace.hpp>
+#include "dircache.h"
 #include <string>
 #include <vector>
+#include <memory>
 #include <algorithm>
+#include <cstring>
 
 namespace cli
 {
@@ -41,6 +40,16 @@ namespace cli
     // This tab policy will traverse the file system and update its 
     // internal list of possible completions every time a path separator
     // is processed. For windows this means "\\" and for linux "/".
+    //
+    // The directories are read in the background by a directory_cache
+    // so processing a path separator never blocks. Until the listing is
+    // ready there are no completions, next() and prev() pick up the listing
+    // as soon as it's available. Applications that want to show the
+    // completions right away can poll with listing_poll().
+    //
+    // The completions are kept as a range of the sorted directory listing.
+    // Typing narrows the range with a binary search, starting from the
+    // previous range when a character is appended.
     class filebrowser
     {
     public:
@@ -50,122 +59,182 @@ namespace cli
         {
             fmask_ = mask;
         }
+
+        // Share a directory cache between several inputs. By default
+        // every filebrowser creates its own cache when first needed.
+        void set_directory_cache(const std::shared_ptr<directory_cache>& cache)
+        {
+            cache_ = cache;
+        }
+
+        // Check whether a directory listing is still being read.
+        bool listing_pending() const
+        {
+            return pending_;
+        }
+
+        // Check whether the directory listing is ready and if so update
+        // the completions. Returns true if the completions changed.
+        bool listing_poll()
+        {
+            if (!pending_)
+                return false;
+            std::shared_ptr<const directory_cache::listing> list;
+            if (!cache().fetch(dir_, list))
+                return false;
+            set_listing(*list);
+            return true;
+        }
+
+        // Block until the directory listing is ready and update the completions.
+        void listing_wait()
+        {
+            if (!pending_)
+                return;
+            set_listing(*cache().wait(dir_));
+        }
     protected:
-        filebrowser() : index_(0), fmask_(0) {}
+        filebrowser() : first_(0), last_(0), index_(0), fmask_(0), pending_(false) {}
        ~filebrowser() {}
 
-        std::string next()
+        const std::string& next()
         {
-            if (match_.empty())
-                return "";
-            return match_[++index_ % match_.size()];
+            listing_poll();
+            const path_container::size_type count = last_ - first_;
+            if (!count)
+                return empty_;
+            return paths_[first_ + ++index_ % count];
         }
-        std::string prev()
+        const std::string& prev()
         {
-            if (match_.empty())
-                return "";
+            listing_poll();
+            const path_container::size_type count = last_ - first_;
+            if (!count)
+                return empty_;
             if (index_ > 0) 
                 --index_;
             else
-                index_ = match_.size()-1;
-            return match_[index_ % match_.size()];
+                index_ = count-1;
+            return paths_[first_ + index_ % count];
         }
         
         void update(const std::string& item, int in)
         {
+            update_text(item, in);
+        }
+        void update(const gap_buffer& item, int in)
+        {
+            update_text(item, in);
+        }
+    private:
+        typedef std::vector<std::string> path_container;
+
+        template<typename Text>
+        void update_text(const Text& item, int in)
+        {
 #if defined(_WIN32)
             const int SEPARATOR = '\\';
 #else
             const int SEPARATOR = '/';
 #endif
+            text_assign(filter_, item);
             if (in == SEPARATOR)
-                update_tab_list(item);
-            else
-                search_tab_list(item);
+                update_tab_list(filter_);
+            else if (!pending_)
+                search_tab_list(filter_);
+        }
+
+        directory_cache& cache()
+        {
+            if (!cache_)
+                cache_.reset(new directory_cache);
+            return *cache_;
         }
-    private:
-        typedef std::vector<std::string> path_container;
         
-        void update_tab_list(const std::string& item)
+        // compare the path truncated to the prefix length against the prefix.
+        static int prefix_compare(const std::string& path, const std::string& prefix)
         {
-            using namespace std;
-            using namespace boost;
-            using namespace boost::filesystem;
+            const int ret = std::memcmp(path.data(), prefix.data(), std::min(path.size(), prefix.size()));
+            if (ret)
+                return ret;
+            return path.size() < prefix.size() ? -1 : 0;
+        }
+        struct before_prefix {
+            bool operator()(const std::string& path, const std::string& prefix) const
+            {
+                return prefix_compare(path, prefix) < 0;
+            }
+        };
+        struct after_prefix {
+            bool operator()(const std::string& prefix, const std::string& path) const
+            {
+                return prefix_compare(path, prefix) > 0;
+            }
+        };
 
-            match_.clear();
+        void update_tab_list(const std::string& item)
+        {
             paths_.clear();
-            index_ = 0;
+            prefix_.clear();
+            first_   = 0;
+            last_    = 0;
+            index_   = 0;
+            dir_     = item;
+            pending_ = true;
+            listing_poll();
+        }
 
-            path ph(item);
-            if (!exists(ph))
-                return;
-            
-            try
+        void set_listing(const directory_cache::listing& list)
+        {
+            paths_.clear();
+            for (directory_cache::listing::const_iterator it = list.begin(); it != list.end(); ++it)
             {
-                directory_iterator end;
-                for (directory_iterator it(ph); it != end; ++it)
-                {
-                    const path& p = *it;
 #ifdef LINUX
-                    string s = p.leaf().string();
-                    if (!s.empty() && s[0] == '.' && !(fmask_ & hidden))
-                        continue;
+                if (it->hidden && !(fmask_ & hidden))
+                    continue;
 #endif
-                    string native = p.string(); //(*it).native_file_string();
-#ifdef WINDOWS
-                    replace_first(native, "\\\\", "\\");
-#endif
-                    try {
-                        if (is_directory(*it))
-                        {
-                            if (fmask_ & folders) 
-                                paths_.push_back(native);
-                        }
-                        else
-                        {
-                            if(fmask_ & files) 
-                                paths_.push_back(native);
-                        }
-                    }
-                    catch (const std::exception&) 
-                    {
-                        // e.g. permission denied. 
-                        // simply ignore this for now, todo: fix this
-                    }
-                }
-            }
-            catch (const std::exception&)
-            {
-                paths_.clear();
-                match_.clear();
+                if (it->folder ? (fmask_ & folders) : (fmask_ & files))
+                    paths_.push_back(it->path);
             }
-            sort(paths_.begin(), paths_.end());
-            copy(paths_.begin(), paths_.end(), back_inserter(match_));
-            index_ = 0;
+            pending_ = false;
+            prefix_.clear();
+            first_   = 0;
+            last_    = paths_.size();
+            search_tab_list(filter_);
         }
+
         void search_tab_list(const std::string& filter)
         {
-            match_.clear();
-            if (filter.empty())
+            index_ = 0;
+            // an appended character can only narrow the current range.
+            // anything else starts over from the whole listing.
+            if (filter.size() < prefix_.size() || filter.compare(0, prefix_.size(), prefix_))
             {
-                std::copy(paths_.begin(), paths_.end(), std::back_inserter(match_));
-                return;
+                first_ = 0;
+                last_  = paths_.size();
             }
+            prefix_.assign(filter);
+            if (filter.empty())
+                return;
 
-            // copy all matches from paths_ into match_
-            for (path_container::iterator it = paths_.begin(); it != paths_.end(); ++it)
-            {
-                const std::string& s = *it;
-                if (!strncmp(s.c_str(), filter.c_str(), filter.size()))
-                    match_.push_back(s);
-            }
-            index_ = 0;
+            path_container::const_iterator beg = paths_.begin();
+            path_container::const_iterator first = std::lower_bound(beg + first_, beg + last_, filter, before_prefix());
+            path_container::const_iterator last  = std::upper_bound(first, beg + last_, filter, after_prefix());
+            first_ = first - beg;
+            last_  = last - beg;
         }
 
+        std::shared_ptr<directory_cache> cache_;
         path_container paths_;
-        path_container match_;
+        path_container::size_type first_;
+        path_container::size_type last_;
         path_container::size_type index_;
+        std::string prefix_;
+        std::string empty_;
+        std::string dir_;
+        std::string filter_;
         int fmask_;
+        bool pending_;
     };
 
 } // cli
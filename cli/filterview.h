@@ -0,0 +1,149 @@
+//
+// Copyright (c) 2007 Sami Väisänen
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+#include "config.h"
+
+#include <vector>
+#include <functional>
+#include <cassert>
+
+namespace cli
+{
+    // Filtered_view is a Database policy adaptor. It wraps any other Database
+    // policy and only exposes the rows that match a predicate. The view keeps
+    // a mapping from the visible rows to the rows in the source Database.
+    //
+    // Narrowing the filter, i.e. replacing the predicate with one that only
+    // accepts a subset of the rows accepted by the current predicate (such as
+    // when typing another character of a substring filter) only rescans the
+    // rows that currently match instead of the whole source.
+    //
+    // The view does not know when the source data changes. If rows are
+    // added or removed in the source call refilter().
+    template<typename Database>
+    class filtered_view : public Database
+    {
+    public:
+        typedef typename Database::value value;
+        typedef std::function<bool (const value&)> predicate;
+
+        // Show only the rows matching the predicate. Scans the whole source.
+        void filter(const predicate& pred)
+        {
+            pred_     = pred;
+            filtered_ = false;
+            refilter();
+        }
+
+        // Narrow down the current filter. The new predicate must not accept
+        // any rows that the current predicate rejects. Only the currently
+        // visible rows are scanned.
+        void narrow(const predicate& pred)
+        {
+            if (!filtered_)
+            {
+                filter(pred);
+                return;
+            }
+            pred_ = pred;
+
+            std::vector<int>::size_type keep = 0;
+            for (std::vector<int>::size_type i=0; i<rows_.size(); ++i)
+            {
+                value val;
+                Database::fetch(val, rows_[i]);
+                if (pred_(val))
+                    rows_[keep++] = rows_[i];
+            }
+            rows_.resize(keep);
+        }
+
+        // Rescan the whole source with the current predicate.
+        void refilter()
+        {
+            if (!pred_)
+            {
+                unfilter();
+                return;
+            }
+            const int max = Database::size();
+            rows_.clear();
+            for (int i=0; i<max; ++i)
+            {
+                value val;
+                Database::fetch(val, i);
+                if (pred_(val))
+                    rows_.push_back(i);
+            }
+            filtered_ = true;
+        }
+
+        // Remove the filter and expose all the rows again.
+        void unfilter()
+        {
+            pred_     = predicate();
+            filtered_ = false;
+            rows_.clear();
+        }
+
+        bool is_filtered() const
+        {
+            return filtered_;
+        }
+
+        // Map a visible row to the row in the source Database.
+        int source_row(int row) const
+        {
+            if (!filtered_)
+                return row;
+            assert(row >= 0 && row < static_cast<int>(rows_.size()));
+            return rows_[row];
+        }
+    protected:
+        typedef typename Database::converter converter;
+
+       ~filtered_view() {}
+        filtered_view() : filtered_(false) {}
+
+        void fetch(value& val, int index)
+        {
+            Database::fetch(val, source_row(index));
+        }
+
+        int size() const
+        {
+            if (!filtered_)
+                return Database::size();
+            return static_cast<int>(rows_.size());
+        }
+    private:
+        predicate pred_;
+        std::vector<int> rows_;
+        bool filtered_;
+    };
+
+} // cli
@@ -0,0 +1,301 @@
+//
+// Copyright (c) 2007 Sami Väisänen
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+#include "config.h"
+
+#include "common.h"
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+#include <cassert>
+
+namespace cli
+{
+    // Implements incremental type-ahead search for list and table widgets.
+    // Typed characters are collected into a search prefix and the selection
+    // jumps to the next row starting from the current row whose text starts
+    // with the prefix. Typing the same character again moves on to the next
+    // matching row, wrapping around at the end. Matching is case insensitive.
+    //
+    // The rows are indexed lazily on the first search. The index is a sorted
+    // array of the converted row texts so that every keystroke only does a binary
+    // search inside the range matched by the previous keystroke. The row numbers
+    // of the index are also kept sorted in blocks of BLOCK entries, so finding
+    // the next matching row from the current row is a binary search per block 
+    // instead of a scan of the whole matching range.
+    // The index is rebuilt automatically if the number of rows changes,
+    // otherwise call reindex() after changing the data.
+    class prefix_finder
+    {
+    public:
+        // Drop the current index. It will be rebuilt on the next search.
+        void reindex()
+        {
+            index_.clear();
+            rows_.clear();
+            keys_.clear();
+            size_ = -1;
+            prefix_.clear();
+        }
+
+        // Set the table column to search in. The default is the first column.
+        void search_column(int col)
+        {
+            if (col != column_)
+            {
+                column_ = col;
+                reindex();
+            }
+        }
+
+        // Get the currently typed search prefix.
+        const std::string& search_text() const
+        {
+            return prefix_;
+        }
+    protected:
+       ~prefix_finder() {}
+        prefix_finder() : column_(0), size_(-1), first_(0), last_(0) {}
+
+        // Process a keypress. Row should be the current row. If the keypress
+        // moved the search to a new row the function returns true and row 
+        // is set to the matching row.
+        // Loader is a function object that is called as loader(row, column, str)
+        // to get the text for a row when building the index.
+        template<typename Loader>
+        bool keydown(int raw, int vk, int max, int& row, Loader load)
+        {
+            if (vk == VK_ERASE && !prefix_.empty())
+            {
+                prefix_.resize(prefix_.size() - 1);
+                if (prefix_.empty())
+                    return false;
+                first_ = 0;
+                last_  = static_cast<int>(index_.size());
+                narrow_range();
+                row = next_match(row, false);
+                return true;
+            }
+            if (vk != -1 || raw < 0x20 || raw > 0xFF || max == 0)
+            {
+                reset();
+                return false;
+            }
+
+            if (max != size_)
+                build(max, load);
+
+            if (prefix_.empty())
+            {
+                first_ = 0;
+                last_  = static_cast<int>(index_.size());
+            }
+            const char c = static_cast<char>(std::tolower(raw));
+            const bool repeat = !prefix_.empty() && prefix_.find_first_not_of(c) == std::string::npos;
+            prefix_.push_back(c);
+
+            const int first = first_;
+            const int last  = last_;
+            narrow_range();
+            if (first_ == last_)
+            {
+                // no match. ignore the character and keep the previous match.
+                prefix_.resize(prefix_.size() - 1);
+                first_ = first;
+                last_  = last;
+                // repeating the same character cycles through the matches.
+                if (!repeat)
+                    return false;
+                const int next = next_match(row, true);
+                if (next == row)
+                    return false;
+                row = next;
+                return true;
+            }
+            row = next_match(row, false);
+            return true;
+        }
+
+        void reset()
+        {
+            prefix_.clear();
+        }
+    private:
+        struct entry {
+            std::size_t offset;
+            int len;
+            int row;
+        };
+
+        enum { BLOCK = 1024 };
+
+        struct entry_less {
+            entry_less(const char* keys) : keys_(keys) {}
+            bool operator()(const entry& lhs, const entry& rhs) const
+            {
+                const int ret = std::memcmp(keys_ + lhs.offset, keys_ + rhs.offset, std::min(lhs.len, rhs.len));
+                if (ret)
+                    return ret < 0;
+                if (lhs.len != rhs.len)
+                    return lhs.len < rhs.len;
+                return lhs.row < rhs.row;
+            }
+            const char* keys_;
+        };
+
+        // compare the entry truncated to the prefix length against the prefix.
+        struct prefix_less {
+            prefix_less(const char* keys, const std::string& prefix) : keys_(keys), prefix_(prefix) {}
+            int compare(const entry& e) const
+            {
+                const int len = static_cast<int>(prefix_.size());
+                const int ret = std::memcmp(keys_ + e.offset, prefix_.data(), std::min(e.len, len));
+                if (ret)
+                    return ret;
+                return e.len < len ? -1 : 0;
+            }
+            bool operator()(const entry& e, const std::string&) const
+            {
+                return compare(e) < 0;
+            }
+            bool operator()(const std::string&, const entry& e) const
+            {
+                return compare(e) > 0;
+            }
+            const char* keys_;
+            const std::string& prefix_;
+        };
+
+        template<typename Loader>
+        void build(int max, Loader& load)
+        {
+            index_.clear();
+            keys_.clear();
+            index_.reserve(max);
+
+            std::string str;
+            for (int i=0; i<max; ++i)
+            {
+                str.clear();
+                load(i, column_, str);
+                entry e;
+                e.offset = keys_.size();
+                e.len    = static_cast<int>(str.size());
+                e.row    = i;
+                for (std::string::size_type x=0; x<str.size(); ++x)
+                    keys_.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(str[x]))));
+                index_.push_back(e);
+            }
+            if (keys_.empty())
+                keys_.push_back(0);
+
+            std::sort(index_.begin(), index_.end(), entry_less(&keys_[0]));
+
+            rows_.resize(index_.size());
+            for (std::vector<entry>::size_type i=0; i<index_.size(); ++i)
+                rows_[i] = index_[i].row;
+            for (std::vector<int>::iterator it = rows_.begin(); it < rows_.end(); it += BLOCK)
+                std::sort(it, rows_.end() - it > BLOCK ? it + BLOCK : rows_.end());
+            size_  = max;
+            first_ = 0;
+            last_  = max;
+            prefix_.clear();
+        }
+
+        // find the first matching row after (or at) the current row.
+        // wraps around to the first matching row.
+        int next_match(int current, bool after) const
+        {
+            const int next = lowest_match(after ? current + 1 : current);
+            return next == -1 ? lowest_match(0) : next;
+        }
+
+        // find the lowest matching row not less than the given row or -1.
+        // the blocks inside the matching range are binary searched and 
+        // only the partial blocks at the ends of the range are scanned.
+        int lowest_match(int least) const
+        {
+            int best = -1;
+            int i = first_;
+            while (i < last_)
+            {
+                const int end = (i / BLOCK + 1) * BLOCK;
+                if (i % BLOCK == 0 && end <= last_)
+                {
+                    std::vector<int>::const_iterator it = std::lower_bound(rows_.begin() + i, rows_.begin() + end, least);
+                    if (it != rows_.begin() + end && (best == -1 || *it < best))
+                        best = *it;
+                    i = end;
+                    continue;
+                }
+                for (; i<end && i<last_; ++i)
+                {
+                    const int row = index_[i].row;
+                    if (row >= least && (best == -1 || row < best))
+                        best = row;
+                }
+            }
+            return best;
+        }
+
+        // narrow down the [first_, last_) range to the entries matching the prefix.
+        void narrow_range()
+        {
+            if (index_.empty())
+                return;
+            const prefix_less pred(&keys_[0], prefix_);
+            typedef std::vector<entry>::const_iterator iter;
+            std::pair<iter, iter> range = std::equal_range(index_.begin() + first_,
+                index_.begin() + last_, prefix_, pred);
+            first_ = static_cast<int>(range.first - index_.begin());
+            last_  = static_cast<int>(range.second - index_.begin());
+        }
+
+        std::vector<entry> index_;
+        std::vector<int>   rows_;   // index_ rows sorted within each block
+        std::vector<char>  keys_;
+        std::string prefix_;
+        int column_;
+        int size_;
+        int first_;
+        int last_;
+    };
+
+    // No type-ahead search at all.
+    class default_finder
+    {
+    protected:
+       ~default_finder() {}
+
+        template<typename Loader>
+        inline bool keydown(int, int, int, int&, Loader) { return false; }
+        inline void reset() {}
+    };
+
+} // cli
@@ -29,8 +29,10 @@
 
 #include "buffer.h"
 #include "common.h"
+#include "unicode.h"
 #include <cassert>
 #include <cstring>
+#include <algorithm>
 
 namespace cli
 {
@@ -85,63 +87,66 @@ namespace cli
             fillblank_ = fill;
         }
         
-        // Transfer a NUL terminated string into the frame buffer. 
-        // The space reserved for this string is given in width.
-        // If width is greater than the length of the string, the remaining
+        // Transfer a NUL terminated UTF-8 string into the frame buffer. 
+        // The space reserved for this string is given in width cells.
+        // If width is greater than the width of the string, the remaining
         // cells are filled either with blanks or with default cell attributes.
         void print(const char* s, size_t width)
         {
             assert(s);
-            size_t x = posx_;
-            size_t y = posy_;
-            bool got_null = false;
-            for (size_t i=0; i<width && x<fb_.cols(); ++i, ++x)
-            {
-                if (!got_null)
-                    got_null = s[i] == 0;
-
-                buffer::row_type& r = fb_[y];
-                assert(x >= 0);
-                assert(x < r.size());
-                if (got_null)
-                {
-                    if (fillblank_)
-                        r[x] = default_;
-                    else
-                        r[x] = blank_;
-                }
-                else
-                {
-                    r[x] = default_;
-                    r[x].value = s[i];
-                }
-            }
+            print(s, std::strlen(s), width);
         }
         
-        // As above, except that the string length is specified explicitly.
+        // As above, except that the string length in bytes is specified explicitly.
         void print(const char* s, size_t len, size_t width)
         {
             assert(s);
+            if (posx_ >= fb_.cols())
+                return;
+
+            buffer::row_type& r = fb_[posy_];
+            const size_t end = std::min(posx_ + width, fb_.cols());
             size_t x = posx_;
-            size_t y = posy_;
-            for (size_t i=0; i<width && x<fb_.cols(); ++i, ++x)
+
+            // plain ASCII maps one byte to one cell.
+            const size_t ascii = std::min(len, end - x);
+            if (is_ascii(s, ascii))
             {
-                buffer::row_type& r = fb_[y];
-                assert(x >= 0);
-                assert(x < r.size());
-                if (i<len)
+                for (size_t i=0; i<ascii; ++i, ++x)
                 {
                     r[x] = default_;
                     r[x].value = s[i];
                 }
-                else
+            }
+            else
+            {
+                const char* str = s;
+                const char* last = s + len;
+                while (str < last && x < end)
                 {
-                    if (fillblank_)
-                        r[x] = default_;
-                    else
-                        r[x] = blank_;
+                    const int cp = utf8_decode(str, last);
+                    const int w  = char_width(cp);
+                    if (w == 0)
+                        continue;
+                    if (w == 2 && x + 1 >= end)
+                        break;
+                    r[x] = default_;
+                    r[x].value = cp;
+                    if (w == 2)
+                    {
+                        r[++x] = default_;
+                        r[x].value = CELL_WIDE_TAIL;
+                    }
+                    ++x;
                 }
             }
+            for (; x<end; ++x)
+            {
+                if (fillblank_)
+                    r[x] = default_;
+                else
+                    r[x] = blank_;
+            }
         }
         
         // Move the internal pointer to a new
@@ -0,0 +1,227 @@
+//
+// Copyright (c) 2007 Sami Visnen
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "config.h"
+
+#include "framedump.h"
+#include "varint.h"
+#include "buffer.h"
+#include <stdexcept>
+#include <algorithm>
+#include <cassert>
+
+namespace {
+    const char MAGIC[4] = {'C', 'L', 'I', 'F'};
+    const unsigned VERSION = 2;
+
+} // namespace
+
+namespace cli
+{
+
+frame_writer::frame_writer(std::ostream& out, int rows, int cols, int keyframe_interval) 
+    : out_(out), rows_(rows), cols_(cols), interval_(keyframe_interval), frames_(0)
+{
+    out_.write(MAGIC, sizeof(MAGIC));
+    write_varint(out_, VERSION);
+    write_varint(out_, rows);
+    write_varint(out_, cols);
+}
+
+void frame_writer::write(const buffer& fb)
+{
+    write(fb, make_rect(0, 0, cols_, rows_));
+}
+
+void frame_writer::write(const buffer& fb, const rect& dirty)
+{
+    assert(static_cast<int>(fb.rows()) == rows_ && static_cast<int>(fb.cols()) == cols_);
+
+    if (frames_ == 0 || (interval_ && frames_ % interval_ == 0))
+        keyframe(fb);
+    else 
+        delta(fb, dirty);
+    ++frames_;
+}
+
+void frame_writer::keyframe(const buffer& fb)
+{
+    prev_.resize(rows_ * cols_);
+    for (int row=0; row<rows_; ++row)
+        std::copy(fb[row].begin(), fb[row].end(), prev_.begin() + row * cols_);
+
+    out_.put(static_cast<char>(FRAME_KEY));
+    runs(&prev_[0], rows_ * cols_);
+}
+
+void frame_writer::delta(const buffer& fb, const rect& dirty)
+{
+    out_.put(static_cast<char>(FRAME_DELTA));
+
+    // the end position of the previous span.
+    int last = 0;
+    for (int row=dirty.top; row<dirty.bottom; ++row)
+    {
+        const buffer::row_type& cur = fb[row];
+        cell* prev = &prev_[row * cols_];
+        int col = dirty.left;
+        while (col < dirty.right)
+        {
+            if (cur[col] == prev[col])
+            {
+                ++col;
+                continue;
+            }
+            const int start = col;
+            while (col < dirty.right && !(cur[col] == prev[col]))
+            {
+                prev[col] = cur[col];
+                ++col;
+            }
+            const int pos = row * cols_ + start;
+            write_varint(out_, pos - last);
+            write_varint(out_, col - start);
+            runs(prev + start, col - start);
+            last = row * cols_ + col;
+        }
+    }
+    write_varint(out_, 0);
+    write_varint(out_, 0);
+}
+
+void frame_writer::runs(const cell* cells, int count)
+{
+    int i = 0;
+    while (i < count)
+    {
+        const cell& c = cells[i];
+        int len = 1;
+        while (i + len < count && cells[i + len] == c)
+            ++len;
+        write_varint(out_, len);
+        write_svarint(out_, c.value);
+        write_varint(out_, static_cast<unsigned short>(c.attrib));
+        write_varint(out_, static_cast<unsigned short>(c.color));
+        write_varint(out_, c.fg);
+        write_varint(out_, c.bg);
+        i += len;
+    }
+}
+
+frame_reader::frame_reader(std::istream& in) : in_(in), rows_(0), cols_(0)
+{
+    char magic[4] = {};
+    in_.read(magic, sizeof(magic));
+    unsigned long long version = 0;
+    if (!in_ || !std::equal(magic, magic + 4, MAGIC) || !read_varint(in_, version))
+        throw std::runtime_error("not a frame dump");
+    if (version != VERSION)
+        throw std::runtime_error("unsupported frame dump version");
+    if (!read_varint(in_, rows_) || !read_varint(in_, cols_))
+        throw std::runtime_error("truncated frame dump header");
+}
+
+bool frame_reader::next(buffer& fb, rect* dirty)
+{
+    const int type = in_.get();
+    if (type == FRAME_KEY)
+    {
+        fb.resize(rows_, cols_);
+        if (!runs(fb, 0, rows_ * cols_))
+            return false;
+        if (dirty)
+            *dirty = make_rect(0, 0, cols_, rows_);
+        return true;
+    }
+    else if (type != FRAME_DELTA)
+        return false;
+
+    if (static_cast<int>(fb.rows()) != rows_ || static_cast<int>(fb.cols()) != cols_)
+        return false;
+
+    rect rc = {};
+    int pos = 0;
+    while (true)
+    {
+        int skip  = 0;
+        int count = 0;
+        if (!read_varint(in_, skip) || !read_varint(in_, count))
+            return false;
+        if (count == 0)
+            break;
+        pos += skip;
+        if (!runs(fb, pos, count))
+            return false;
+        // spans never wrap over a row.
+        const int row = pos / cols_;
+        const int col = pos % cols_;
+        rc   = rect_union(rc, make_rect(col, row, count, 1));
+        pos += count;
+    }
+    if (dirty)
+        *dirty = rc;
+    return true;
+}
+
+bool frame_reader::runs(buffer& fb, int pos, int count)
+{
+    const int max = rows_ * cols_;
+    if (pos < 0 || count < 0 || pos + count > max)
+        return false;
+
+    while (count)
+    {
+        int len = 0;
+        cell c;
+        int attrib = 0;
+        int color  = 0;
+        unsigned long long fg = 0;
+        unsigned long long bg = 0;
+        if (!read_varint(in_, len) || !read_svarint(in_, c.value) ||
+            !read_varint(in_, attrib) || !read_varint(in_, color) ||
+            !read_varint(in_, fg) || !read_varint(in_, bg))
+            return false;
+        if (len <= 0 || len > count)
+            return false;
+        c.attrib = static_cast<short>(attrib);
+        c.color  = static_cast<short>(color);
+        c.fg     = static_cast<unsigned>(fg);
+        c.bg     = static_cast<unsigned>(bg);
+        count -= len;
+        while (len)
+        {
+            // a run can continue over to the next row.
+            buffer::row_type& row = fb[pos / cols_];
+            const int col = pos % cols_;
+            const int n   = std::min(len, cols_ - col);
+            std::fill(row.begin() + col, row.begin() + col + n, c);
+            pos += n;
+            len -= n;
+        }
+    }
+    return true;
+}
+
+} // cli
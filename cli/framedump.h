@@ -0,0 +1,125 @@
+//
+// Copyright (c) 2007 Sami Visnen
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+#include "config.h"
+
+#include <istream>
+#include <ostream>
+#include <vector>
+#include "common.h"
+
+namespace cli
+{
+    class buffer;
+
+    // Frame dumps. A frame dump is a compact binary log of the contents of
+    // a buffer over time, for archiving sessions and for golden frame tests.
+    // The first frame is stored whole as a keyframe and the frames after it
+    // as deltas against the previous frame, i.e. only the cells that changed.
+    // Runs of identical cells are run length encoded in both cases, so the
+    // blank areas in a keyframe and a scrolled page of a table both shrink to
+    // a fraction of the raw buffer size.
+    //
+    // The file format is a small header followed by the frames.
+    // header  : "CLIF" version rows cols
+    // keyframe: 1 runs covering all the cells in row major order
+    // delta   : 2 { skip count runs covering count cells } 0 0
+    // run     : length value attrib color fg bg
+    // All the numbers are varints, value is signed. Skip is the number of 
+    // unchanged cells since the end of the previous span.
+
+    enum frame_dump_type {
+        FRAME_KEY   = 1,
+        FRAME_DELTA = 2
+    };
+
+    // Writes frames into a stream.
+    class frame_writer
+    {
+    public:
+        // Keyframe_interval is the number of frames between keyframes.
+        // 0 means only the first frame is a keyframe. More keyframes make
+        // the dump bigger but let a reader start from the middle.
+        frame_writer(std::ostream& out, int rows, int cols, int keyframe_interval = 0);
+
+        // Write the whole buffer. The cells are compared against
+        // the previous frame to find the ones that changed.
+        void write(const buffer& fb);
+
+        // Write the buffer when only the cells inside the dirty rectangle
+        // can have changed since the previous frame, such as the rectangle
+        // returned by window::draw. Only the dirty cells are compared.
+        void write(const buffer& fb, const rect& dirty);
+
+        // Get the number of frames written.
+        int frames() const
+        {
+            return frames_;
+        }
+    private:
+        void keyframe(const buffer& fb);
+        void delta(const buffer& fb, const rect& dirty);
+        void runs(const cell* cells, int count);
+
+        std::ostream& out_;
+        std::vector<cell> prev_;
+        int rows_;
+        int cols_;
+        int interval_;
+        int frames_;
+    };
+
+    // Reads frames from a stream.
+    class frame_reader
+    {
+    public:
+        // Reads the header. Throws std::runtime_error if the stream is not a frame dump.
+        frame_reader(std::istream& in);
+
+        int rows() const
+        {
+            return rows_;
+        }
+        int cols() const
+        {
+            return cols_;
+        }
+
+        // Read the next frame into the buffer. The buffer must hold the previous
+        // frame read by this reader (a keyframe resizes it). Returns false at the
+        // end of the dump. If dirty is given it is set to the rectangle 
+        // covering the cells that changed.
+        bool next(buffer& fb, rect* dirty = nullptr);
+    private:
+        bool runs(buffer& fb, int pos, int count);
+
+        std::istream& in_;
+        int rows_;
+        int cols_;
+    };
+
+} // cli
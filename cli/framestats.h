@@ -0,0 +1,155 @@
+//
+// Copyright (c) 2007 Sami Visnen
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+#include "config.h"
+
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+namespace cli
+{
+    class widget;
+
+    // Statistics of a single frame recorded by the window.
+    // All times are in microseconds.
+    struct frame_stats {
+        struct widget_time {
+            const widget* w;
+            int draw_us;
+        };
+        int erase_us;      // time spent erasing (evterase handler)
+        int draw_us;       // time spent in draw, including erase
+        int animate_us;    // time spent in the last animate
+        int drawn;         // number of widgets drawn
+        int skipped;       // number of valid widgets that were skipped
+        int dirty_cells;   // size of the returned dirty rectangle in cells
+        int bytes_out;     // bytes output by the terminal backend, see window::record_output
+        std::vector<widget_time> widgets; // draw time of every drawn widget
+    };
+
+    // Rolling_histogram keeps the last N samples of some value
+    // and computes statistics over them. 
+    class rolling_histogram
+    {
+    public:
+        rolling_histogram(std::size_t capacity = 120) : samples_(capacity), next_(0), count_(0)
+        {
+            assert(capacity);
+        }
+
+        // Add a new sample. Once the histogram is full the oldest sample is dropped.
+        void add(int value)
+        {
+            samples_[next_] = value;
+            next_ = (next_ + 1) % samples_.size();
+            if (count_ < samples_.size())
+                ++count_;
+        }
+
+        void clear()
+        {
+            next_  = 0;
+            count_ = 0;
+        }
+
+        // Get the number of samples currently in the histogram.
+        std::size_t count() const
+        {
+            return count_;
+        }
+
+        // Get a sample, 0 being the oldest.
+        int sample(std::size_t i) const
+        {
+            assert(i < count_);
+            return samples_[(next_ + samples_.size() - count_ + i) % samples_.size()];
+        }
+
+        int min() const
+        {
+            if (!count_) return 0;
+            int ret = sample(0);
+            for (std::size_t i=1; i<count_; ++i)
+                ret = std::min(ret, sample(i));
+            return ret;
+        }
+
+        int max() const
+        {
+            if (!count_) return 0;
+            int ret = sample(0);
+            for (std::size_t i=1; i<count_; ++i)
+                ret = std::max(ret, sample(i));
+            return ret;
+        }
+
+        double mean() const
+        {
+            if (!count_) return 0.0;
+            double sum = 0.0;
+            for (std::size_t i=0; i<count_; ++i)
+                sum += sample(i);
+            return sum / count_;
+        }
+
+        // Get the value below which the given fraction (0.0 - 1.0) of the samples fall.
+        int percentile(double p) const
+        {
+            if (!count_) return 0;
+            // until the histogram is full the samples are at the beginning,
+            // after that all of the samples are in use. order doesn't matter.
+            sorted_.assign(samples_.begin(), samples_.begin() + count_);
+            std::size_t n = static_cast<std::size_t>(p * (count_ - 1) + 0.5);
+            if (n >= count_)
+                n = count_ - 1;
+            std::nth_element(sorted_.begin(), sorted_.begin() + n, sorted_.end());
+            return sorted_[n];
+        }
+
+        // Count the samples into buckets of the given width. 
+        // Bucket i counts the samples in [i * width, (i+1) * width), the
+        // last bucket also counts everything above.
+        void buckets(int width, std::vector<int>& out) const
+        {
+            assert(width > 0);
+            assert(!out.empty());
+            std::fill(out.begin(), out.end(), 0);
+            for (std::size_t i=0; i<count_; ++i)
+            {
+                const std::size_t b = std::min<std::size_t>(std::max(sample(i), 0) / width, out.size() - 1);
+                ++out[b];
+            }
+        }
+    private:
+        std::vector<int> samples_;
+        std::size_t next_;
+        std::size_t count_;
+        mutable std::vector<int> sorted_;
+    };
+
+} // cli
@@ -0,0 +1,420 @@
+//
+// Copyright (c) 2007 Sami Visnen
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+#include "config.h"
+
+#include "gapbuffer.h"
+#include <string>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <cassert>
+
+namespace cli
+{
+    // Fuzzy matching in the style of fzf. The pattern matches a candidate
+    // if its characters appear in the candidate in order, with anything in 
+    // between. Matches are scored so that characters at word boundaries
+    // and runs of consecutive characters score high and gaps cost a little.
+    // Matching is case insensitive unless the pattern has upper case letters.
+
+    enum fuzzy_scores {
+        FUZZY_SCORE_MATCH         = 16,
+        FUZZY_SCORE_GAP_START     = -3,
+        FUZZY_SCORE_GAP_EXTENSION = -1,
+        FUZZY_BONUS_BOUNDARY      = 8,
+        FUZZY_BONUS_CAMEL         = 7,
+        FUZZY_BONUS_CONSECUTIVE   = 4
+    };
+
+    // Don't bother with threads for less than this many candidates.
+    enum { FUZZY_PARALLEL_MIN = 1 << 14 };
+
+    namespace detail {
+        inline
+        char fuzzy_fold(char c, bool case_sensitive)
+        {
+            return (!case_sensitive && c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+        }
+
+        inline
+        bool fuzzy_alnum(char c)
+        {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || (c & 0x80);
+        }
+
+        // bonus for matching the character at position i.
+        inline
+        int fuzzy_bonus(const char* text, size_t i)
+        {
+            if (i == 0)
+                return FUZZY_BONUS_BOUNDARY;
+            const char prev = text[i-1];
+            const char cur  = text[i];
+            if (!fuzzy_alnum(prev) && fuzzy_alnum(cur))
+                return FUZZY_BONUS_BOUNDARY;
+            if (prev >= 'a' && prev <= 'z' && cur >= 'A' && cur <= 'Z')
+                return FUZZY_BONUS_CAMEL;
+            return 0;
+        }
+    } // detail
+
+    // Score the text against the pattern. The pattern must already be lower
+    // case if case_sensitive is false. Returns false if the text doesn't match.
+    inline
+    bool fuzzy_score(const char* pattern, size_t plen, const char* text, size_t tlen, bool case_sensitive, int& score)
+    {
+        score = 0;
+        if (plen == 0)
+            return true;
+
+        // find where the first greedy match ends.
+        size_t p   = 0;
+        size_t end = 0;
+        for (size_t i=0; i<tlen; ++i)
+        {
+            if (detail::fuzzy_fold(text[i], case_sensitive) == pattern[p] && ++p == plen)
+            {
+                end = i + 1;
+                break;
+            }
+        }
+        if (p != plen)
+            return false;
+
+        // walk back to find the shortest match ending there.
+        size_t start = end;
+        while (p)
+        {
+            --start;
+            if (detail::fuzzy_fold(text[start], case_sensitive) == pattern[p-1])
+                --p;
+        }
+
+        bool consecutive = false;
+        bool gap = false;
+        for (size_t i=start; i<end; ++i)
+        {
+            if (p < plen && detail::fuzzy_fold(text[i], case_sensitive) == pattern[p])
+            {
+                int bonus = detail::fuzzy_bonus(text, i);
+                if (consecutive)
+                    bonus = std::max<int>(bonus, FUZZY_BONUS_CONSECUTIVE);
+                if (p == 0)
+                    bonus *= 2;
+                score += FUZZY_SCORE_MATCH + bonus;
+                consecutive = true;
+                gap = false;
+                ++p;
+            }
+            else
+            {
+                score += gap ? FUZZY_SCORE_GAP_EXTENSION : FUZZY_SCORE_GAP_START;
+                consecutive = false;
+                gap = true;
+            }
+        }
+        return true;
+    }
+
+    namespace detail {
+        struct fuzzy_entry {
+            unsigned offset;
+            unsigned len;
+        };
+
+        struct fuzzy_rank {
+            int score;
+            unsigned len;
+            int index;
+        };
+
+        // higher score first, then shorter, then earlier in the list.
+        inline
+        bool fuzzy_better(const fuzzy_rank& lhs, const fuzzy_rank& rhs)
+        {
+            if (lhs.score != rhs.score)
+                return lhs.score > rhs.score;
+            if (lhs.len != rhs.len)
+                return lhs.len < rhs.len;
+            return lhs.index < rhs.index;
+        }
+
+        // a slice of the candidates scanned by one thread.
+        struct fuzzy_chunk {
+            const char* chars;
+            const fuzzy_entry* entries;
+            const int* ids;         // candidates to scan, or null for [first, last)
+            int first;
+            int last;
+            const std::string* pattern;
+            bool case_sensitive;
+            size_t max;
+            std::vector<fuzzy_rank> top;  // heap of the best matches, worst on top
+            std::vector<int> matched;     // every matching candidate
+        };
+
+        inline
+        void fuzzy_scan(fuzzy_chunk* chunk)
+        {
+            chunk->top.clear();
+            chunk->matched.clear();
+            const std::string& pattern = *chunk->pattern;
+            for (int i=chunk->first; i<chunk->last; ++i)
+            {
+                const int index = chunk->ids ? chunk->ids[i] : i;
+                const fuzzy_entry& e = chunk->entries[index];
+                fuzzy_rank rank;
+                if (!fuzzy_score(pattern.data(), pattern.size(), chunk->chars + e.offset, e.len, chunk->case_sensitive, rank.score))
+                    continue;
+                rank.len   = e.len;
+                rank.index = index;
+                chunk->matched.push_back(index);
+                if (chunk->top.size() < chunk->max)
+                {
+                    chunk->top.push_back(rank);
+                    std::push_heap(chunk->top.begin(), chunk->top.end(), fuzzy_better);
+                }
+                else if (fuzzy_better(rank, chunk->top.front()))
+                {
+                    std::pop_heap(chunk->top.begin(), chunk->top.end(), fuzzy_better);
+                    chunk->top.back() = rank;
+                    std::push_heap(chunk->top.begin(), chunk->top.end(), fuzzy_better);
+                }
+            }
+        }
+    } // detail
+
+    // Fuzzy_tablist is a tab completion policy that ranks the candidates 
+    // by how well they fuzzy match the input and keeps the best ones. Tab 
+    // completion cycles through them from the best down.
+    //
+    // Large candidate lists are scanned in parallel, each thread keeping 
+    // a small heap of its best matches. Since typing another character can
+    // only remove matches, the next keystroke only rescans the candidates 
+    // that matched the previous input.
+    class fuzzy_tablist
+    {
+    public:
+        typedef std::vector<std::string> list;
+
+        void setlist(const list& tabs)
+        {
+            chars_.clear();
+            entries_.clear();
+            entries_.reserve(tabs.size());
+            for (list::size_type i=0; i<tabs.size(); ++i)
+            {
+                detail::fuzzy_entry e;
+                e.offset = static_cast<unsigned>(chars_.size());
+                e.len    = static_cast<unsigned>(tabs[i].size());
+                chars_.insert(chars_.end(), tabs[i].begin(), tabs[i].end());
+                entries_.push_back(e);
+            }
+            if (chars_.empty())
+                chars_.push_back(0);
+            filtered_ = false;
+            pattern_.clear();
+            rank();
+        }
+
+        // Set the number of best matches to keep. The default is 50.
+        void set_max_matches(int max)
+        {
+            assert(max > 0);
+            max_ = max;
+        }
+
+        // Set the number of threads to use for large lists.
+        void set_threads(unsigned threads)
+        {
+            threads_ = threads ? threads : 1;
+        }
+
+        // Get the number of candidates.
+        int size() const
+        {
+            return static_cast<int>(entries_.size());
+        }
+
+        // Get the number of candidates matching the current input.
+        int match_count() const
+        {
+            return filtered_ ? static_cast<int>(matched_.size()) : size();
+        }
+
+        // Get the number of ranked matches, at most max matches.
+        int matches() const
+        {
+            return static_cast<int>(top_.size());
+        }
+
+        // Get the ith best match and its score.
+        std::string match(int i) const
+        {
+            const detail::fuzzy_entry& e = entries_[top_[i].index];
+            return std::string(&chars_[e.offset], e.len);
+        }
+        int match_score(int i) const
+        {
+            return top_[i].score;
+        }
+    protected:
+        fuzzy_tablist() : max_(50), threads_(std::max(1u, std::thread::hardware_concurrency())), 
+            filtered_(false), pos_(-1) 
+        {
+            chars_.push_back(0);
+        }
+       ~fuzzy_tablist() {}
+
+        const std::string& next()
+        {
+            if (top_.empty())
+                return current(-1);
+            pos_ = (pos_ + 1) % static_cast<int>(top_.size());
+            return current(pos_);
+        }
+        const std::string& prev()
+        {
+            if (top_.empty())
+                return current(-1);
+            pos_ = pos_ <= 0 ? static_cast<int>(top_.size()) - 1 : pos_ - 1;
+            return current(pos_);
+        }
+
+        void update(const std::string& input, char)
+        {
+            update_text(input);
+        }
+        void update(const gap_buffer& input, char)
+        {
+            update_text(input);
+        }
+    private:
+        template<typename Text>
+        void update_text(const Text& input)
+        {
+            const bool extends = text_starts_with(input, pattern_);
+            if (extends && input.size() == pattern_.size())
+                return;
+            // matches of a longer pattern are a subset of the current matches.
+            const bool narrow = filtered_ && extends;
+            text_assign(pattern_, input);
+            rank(narrow);
+        }
+
+        void rank(bool narrow = false)
+        {
+            top_.clear();
+            pos_ = -1;
+            if (pattern_.empty())
+            {
+                // everything matches equally. keep the list order.
+                filtered_ = false;
+                matched_.clear();
+                for (int i=0; i<size() && i<max_; ++i)
+                {
+                    const detail::fuzzy_rank r = {0, entries_[i].len, i};
+                    top_.push_back(r);
+                }
+                return;
+            }
+
+            // smart case.
+            folded_ = pattern_;
+            bool case_sensitive = false;
+            for (size_t i=0; i<folded_.size(); ++i)
+                case_sensitive |= folded_[i] >= 'A' && folded_[i] <= 'Z';
+            for (size_t i=0; i<folded_.size(); ++i)
+                folded_[i] = detail::fuzzy_fold(folded_[i], case_sensitive);
+
+            const int count = narrow ? static_cast<int>(matched_.size()) : size();
+            const unsigned threads = count < FUZZY_PARALLEL_MIN ? 1 : threads_;
+            if (narrow)
+                ids_.swap(matched_);
+
+            chunks_.resize(threads);
+            for (unsigned i=0; i<threads; ++i)
+            {
+                detail::fuzzy_chunk& chunk = chunks_[i];
+                chunk.chars    = &chars_[0];
+                chunk.entries  = entries_.empty() ? nullptr : &entries_[0];
+                chunk.ids      = narrow && !ids_.empty() ? &ids_[0] : nullptr;
+                chunk.first    = static_cast<int>(static_cast<long long>(count) * i / threads);
+                chunk.last     = static_cast<int>(static_cast<long long>(count) * (i + 1) / threads);
+                chunk.pattern  = &folded_;
+                chunk.case_sensitive = case_sensitive;
+                chunk.max      = max_;
+            }
+            std::vector<std::thread> workers;
+            for (unsigned i=1; i<threads; ++i)
+                workers.push_back(std::thread(detail::fuzzy_scan, &chunks_[i]));
+            detail::fuzzy_scan(&chunks_[0]);
+            for (std::size_t i=0; i<workers.size(); ++i)
+                workers[i].join();
+
+            // merge the results of the chunks.
+            matched_.clear();
+            for (unsigned i=0; i<threads; ++i)
+            {
+                matched_.insert(matched_.end(), chunks_[i].matched.begin(), chunks_[i].matched.end());
+                top_.insert(top_.end(), chunks_[i].top.begin(), chunks_[i].top.end());
+            }
+            const std::size_t keep = std::min<std::size_t>(top_.size(), max_);
+            std::partial_sort(top_.begin(), top_.begin() + keep, top_.end(), detail::fuzzy_better);
+            top_.resize(keep);
+            filtered_ = true;
+        }
+
+        const std::string& current(int i)
+        {
+            if (i == -1)
+            {
+                current_.clear();
+                return current_;
+            }
+            const detail::fuzzy_entry& e = entries_[top_[i].index];
+            current_.assign(&chars_[e.offset], e.len);
+            return current_;
+        }
+
+        std::vector<char> chars_;
+        std::vector<detail::fuzzy_entry> entries_;
+        std::vector<detail::fuzzy_rank>  top_;
+        std::vector<detail::fuzzy_chunk> chunks_;
+        std::vector<int> matched_;
+        std::vector<int> ids_;
+        std::string pattern_;
+        std::string folded_;
+        std::string current_;
+        int  max_;
+        unsigned threads_;
+        bool filtered_;
+        int  pos_;
+    };
+
+} // cli
@@ -0,0 +1,197 @@
+//
+// Copyright (c) 2007 Sami Visnen
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+#include "config.h"
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cassert>
+
+namespace cli
+{
+    // Gap_buffer is a character sequence optimized for editing at a cursor.
+    // The free space of the buffer is kept as a gap at the last edit position,
+    // so inserting and erasing at or near the same position is amortized O(1)
+    // no matter how long the text is. Moving the edit position costs a copy
+    // of the characters between the old and the new position.
+    class gap_buffer
+    {
+    public:
+        gap_buffer() : gap_begin_(0), gap_end_(0) {}
+
+        // Get the number of characters.
+        size_t size() const
+        {
+            return buf_.size() - (gap_end_ - gap_begin_);
+        }
+        bool empty() const
+        {
+            return size() == 0;
+        }
+
+        char operator[](size_t i) const
+        {
+            assert(i < size());
+            return i < gap_begin_ ? buf_[i] : buf_[i + gap_end_ - gap_begin_];
+        }
+
+        void insert(size_t pos, char c)
+        {
+            insert(pos, &c, 1);
+        }
+
+        // Insert len characters at pos.
+        void insert(size_t pos, const char* s, size_t len)
+        {
+            assert(pos <= size());
+            reserve_gap(len);
+            move_gap(pos);
+            std::copy(s, s + len, buf_.begin() + gap_begin_);
+            gap_begin_ += len;
+        }
+
+        // Erase count characters starting at pos.
+        void erase(size_t pos, size_t count)
+        {
+            assert(pos + count <= size());
+            move_gap(pos);
+            gap_end_ += count;
+        }
+
+        // Replace the contents. The storage is kept.
+        void assign(const char* s, size_t len)
+        {
+            clear();
+            insert(0, s, len);
+        }
+        void assign(const std::string& s)
+        {
+            assign(s.data(), s.size());
+        }
+
+        // Erase everything. The storage is kept.
+        void clear()
+        {
+            gap_begin_ = 0;
+            gap_end_   = buf_.size();
+        }
+
+        // Copy the characters [pos, pos + len) into out.
+        void copy(size_t pos, size_t len, char* out) const
+        {
+            assert(pos + len <= size());
+            const size_t end = pos + len;
+            if (pos < gap_begin_)
+            {
+                const size_t n = std::min(end, gap_begin_) - pos;
+                out = std::copy(buf_.begin() + pos, buf_.begin() + pos + n, out);
+                pos += n;
+            }
+            if (pos < end)
+            {
+                const size_t gap = gap_end_ - gap_begin_;
+                std::copy(buf_.begin() + pos + gap, buf_.begin() + end + gap, out);
+            }
+        }
+
+        // Get the contents as a string.
+        std::string str() const
+        {
+            std::string ret;
+            ret.resize(size());
+            if (!ret.empty())
+                copy(0, ret.size(), &ret[0]);
+            return ret;
+        }
+    private:
+        // move the gap to start at pos.
+        void move_gap(size_t pos)
+        {
+            if (pos < gap_begin_)
+            {
+                const size_t n = gap_begin_ - pos;
+                std::copy_backward(buf_.begin() + pos, buf_.begin() + gap_begin_, buf_.begin() + gap_end_);
+                gap_begin_ -= n;
+                gap_end_   -= n;
+            }
+            else if (pos > gap_begin_)
+            {
+                const size_t n = pos - gap_begin_;
+                std::copy(buf_.begin() + gap_end_, buf_.begin() + gap_end_ + n, buf_.begin() + gap_begin_);
+                gap_begin_ += n;
+                gap_end_   += n;
+            }
+        }
+
+        // make sure the gap has room for at least len characters.
+        void reserve_gap(size_t len)
+        {
+            const size_t gap = gap_end_ - gap_begin_;
+            if (gap >= len)
+                return;
+            const size_t tail = buf_.size() - gap_end_;
+            const size_t capacity = std::max(buf_.size() * 2, size() + len + 16);
+            buf_.resize(capacity);
+            // move the text after the gap to the new end.
+            std::copy_backward(buf_.begin() + gap_end_, buf_.begin() + gap_end_ + tail, buf_.end());
+            gap_end_ = capacity - tail;
+        }
+
+        std::vector<char> buf_;
+        size_t gap_begin_;
+        size_t gap_end_;
+    };
+
+    // Tab completion policies see the input either as a string or as
+    // the gap buffer of the input widget. These work with both.
+    template<typename Text>
+    bool text_starts_with(const Text& text, const std::string& prefix)
+    {
+        if (text.size() < prefix.size())
+            return false;
+        for (size_t i=0; i<prefix.size(); ++i)
+        {
+            if (text[i] != prefix[i])
+                return false;
+        }
+        return true;
+    }
+
+    // Copy the text into a string. The storage of the string is kept.
+    inline void text_assign(std::string& out, const std::string& text)
+    {
+        out.assign(text);
+    }
+    inline void text_assign(std::string& out, const gap_buffer& text)
+    {
+        out.resize(text.size());
+        if (!out.empty())
+            text.copy(0, out.size(), &out[0]);
+    }
+
+} // cli
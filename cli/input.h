@@ -31,7 +31,9 @@
 #include "common.h"
 #include "inputpolicy.h"
 #include "formatter.h"
+#include "gapbuffer.h"
 #include <functional>
+#include <utility>
 #include <string>
 #include <cassert>
 
@@ -41,9 +43,19 @@ namespace cli
     // Policies it can be configured to do different things.
     //
     // OutputMask - Output masking policy, which controls how input string gets printed. 
+    //              Provides char screen(char) to mask the visible characters one at a
+    //              time. Policies that only provide std::string screen(const std::string&)
+    //              are given one character strings instead.
     // InputMask  - Input masking policy, which controls which input keys get accepted.
-    // TabList    - Tab completion policy. 
+    // TabList    - Tab completion policy. Provides next(), prev() and update(input, raw),
+    //              update is given the input as a gap_buffer and the inserted character,
+    //              or 0 for other edits. Policies taking the input as a std::string get a
+    //              copy of it.
     // VKMask     - Virtual Key masking policy.
+    //
+    // The input text is kept in a gap buffer so editing at the caret 
+    // is cheap even for long inputs, and only the visible part of
+    // the text is masked and drawn.
     template <typename OutputMask = cleartext,
               typename InputMask  = alnum,
               typename TabList    = tabless,
@@ -83,20 +95,21 @@ namespace cli
         
         rect draw(buffer& fb)
         {
-            const cell def = {' ', ATTRIB_NONE, COLOR_NONE};
+            const cell def = {' ', ATTRIB_NONE, COLOR_NONE, 0, 0};
             formatter f(def, fb);
-            
-            std::string input = OutputMask::screen(input_);
-
-            const char* ptr = input.c_str();
-            ptr += insertpos_;
-            ptr -= caretpos_;
 
-            int len = static_cast<int>(input.size());
-            len -= insertpos_;
-            len += caretpos_;
+            // the caret is caretpos_ cells from the start of the visible window.
+            const int first = insertpos_ - caretpos_;
+            const int len   = std::max(0, std::min<int>(width_, static_cast<int>(input_.size()) - first));
+            screen_.resize(len);
+            if (len > 0)
+            {
+                input_.copy(first, len, &screen_[0]);
+                for (int i=0; i<len; ++i)
+                    screen_[i] = screen_char(*this, screen_[i], 0);
+            }
             f.move(xpos_, ypos_);
-            f.print(ptr, len, width_);
+            f.print(screen_.data(), screen_.size(), width_);
 
             rect ret = {ypos_, xpos_, xpos_ + width_, ypos_+1};
             return ret;
@@ -194,18 +207,58 @@ namespace cli
                 return false;
 
             // insert at the caret position
-            std::string s1 = input_.substr(0, insertpos_);
-            std::string s2 = input_.substr(insertpos_);
-
-            input_  = s1;
-            input_ += (char)raw;
-            input_ += s2;
+            input_.insert(insertpos_, (char)raw);
 
             ++insertpos_;
             if (caretpos_ < width_)
                 ++caretpos_;
                 
-            TabList::update(input_, raw);
+            update_tablist(raw);
+
+            if (evtkey)
+                evtkey();
+
+            valid_ = false;
+            return true;
+        }
+
+        // Insert pasted text at the caret. Tabs and line breaks turn into 
+        // spaces, other characters are screened with the InputMask like typed
+        // keys. The whole text is inserted at once and the widget is only
+        // invalidated once.
+        bool paste(const char* text, size_t len)
+        {
+            if (width_ == 0 || len == 0)
+                return false;
+
+            // the common case is that all of the text is acceptable
+            // as is and can be inserted without copying it first.
+            bool clean = true;
+            for (size_t i=0; i<len; ++i)
+                clean &= InputMask::isgood(static_cast<unsigned char>(text[i]));
+
+            size_t count = len;
+            if (!clean)
+            {
+                paste_.clear();
+                for (size_t i=0; i<len; ++i)
+                {
+                    int ch = static_cast<unsigned char>(text[i]);
+                    if (ch == '\t' || ch == '\n' || ch == '\r')
+                        ch = ' ';
+                    if (InputMask::isgood(ch))
+                        paste_.push_back(static_cast<char>(ch));
+                }
+                text  = paste_.data();
+                count = paste_.size();
+                if (count == 0)
+                    return false;
+            }
+            input_.insert(insertpos_, text, count);
+            insertpos_ += static_cast<int>(count);
+            caretpos_   = std::min<int>(caretpos_ + static_cast<int>(count), width_);
+
+            update_tablist(text[count - 1]);
 
             if (evtkey)
                 evtkey();
@@ -228,17 +281,17 @@ namespace cli
         // Get input value string.
         std::string value() const
         {
-            return input_;
+            return input_.str();
         }
         
         // Set input value string. This will reset caret position to the 
         // start of the input string.
         void value(const std::string& val)
         {
-            input_     = val;
+            input_.assign(val);
             insertpos_ = 0;
             caretpos_  = 0;
-            TabList::update(val, 0);
+            update_tablist(0);
             valid_     = false;
         }
 
@@ -249,7 +302,7 @@ namespace cli
             input_.clear();
             insertpos_ = 0;
             caretpos_  = 0;
-            TabList::update("", 0);
+            update_tablist(0);
             valid_     = false;
         }
 
@@ -262,11 +315,12 @@ namespace cli
     private:
         void tab_complete(bool forward)
         {
-            std::string n = forward ? TabList::next() : TabList::prev();
+            // policies may return a reference to avoid copying the string.
+            const std::string& n = forward ? TabList::next() : TabList::prev();
             if (n.empty())
                 return;
 
-            input_     = n;
+            input_.assign(n);
             insertpos_ = static_cast<int>(input_.size());
             caretpos_  = static_cast<int>(input_.size());
             if (caretpos_ > width_)
@@ -275,36 +329,24 @@ namespace cli
 
         void kill_char(bool move_caret)
         {
-            std::string s1;
-            std::string s2;
-
             if (move_caret)
             {
                 if (insertpos_ == 0)
                     return;
         
-                s1 = input_.substr(0, insertpos_-1);
-                if (insertpos_ < static_cast<int>(input_.size()))
-                    s2 = input_.substr(insertpos_);
-
                 --insertpos_;
                 if (caretpos_ > 0)
                     --caretpos_;
+                input_.erase(insertpos_, 1);
             }
             else
             {
-                if (insertpos_ > static_cast<int>(input_.size()))
+                if (insertpos_ >= static_cast<int>(input_.size()))
                     return;
 
-                s1 = input_.substr(0, insertpos_);
-                if (insertpos_ < static_cast<int>(input_.size()))
-                    s2 = input_.substr(insertpos_+1);
+                input_.erase(insertpos_, 1);
             }
-            
-            input_  = s1;
-            input_ += s2;
-            
-            TabList::update(input_, 0);
+            update_tablist(0);
         }
 
         void kill_line()
@@ -313,12 +355,45 @@ namespace cli
             if (insertpos_ > static_cast<int>(input_.size()))
                 return;
 
-            input_ = input_.substr(0, insertpos_);
+            input_.erase(insertpos_, input_.size() - insertpos_);
+
+            update_tablist(0);
+        }
 
-            TabList::update(input_, 0);
+        // tab completion policies get to see the whole input. 
+        void update_tablist(char raw)
+        {
+            update_tabs(*this, raw, 0);
+        }
+
+        // pick the policy overloads by what the policies provide. the int 
+        // argument prefers the first overload when both are viable.
+        template<typename Self>
+        auto update_tabs(Self& self, char raw, int) -> decltype(self.update(std::declval<const gap_buffer&>(), raw))
+        {
+            return TabList::update(input_, raw);
+        }
+        template<typename Self>
+        void update_tabs(Self&, char raw, long)
+        {
+            TabList::update(input_.str(), raw);
+        }
+
+        template<typename Self>
+        auto screen_char(const Self& self, char c, int) const -> decltype(self.screen(c))
+        {
+            return OutputMask::screen(c);
+        }
+        template<typename Self>
+        char screen_char(const Self&, char c, long) const
+        {
+            const std::string s = OutputMask::screen(std::string(1, c));
+            return s.empty() ? ' ' : s[0];
         }
         
-        std::string input_;
+        gap_buffer input_;
+        std::string screen_;
+        std::string paste_;
         int insertpos_;
         int caretpos_;
         int width_;
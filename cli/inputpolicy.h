@@ -32,6 +32,7 @@
 #include <iomanip>
 #include <cctype>
 #include "common.h"
+#include "gapbuffer.h"
 
 namespace cli
 {
@@ -45,6 +46,11 @@ namespace cli
         {
             return input;
         }
+        inline
+        char screen(char c) const
+        {
+            return c;
+        }
     };
 
     class password 
@@ -61,6 +67,11 @@ namespace cli
             ss << std::setw(input.size()) << std::setfill(PASSWORD_CHAR) << "";
             return ss.str();
         }
+        inline
+        char screen(char) const
+        {
+            return PASSWORD_CHAR;
+        }
     };
 
     class alnum // alphanumeric input
@@ -103,7 +114,8 @@ namespace cli
        ~tabless() {}
         inline std::string next() { return ""; }
         inline std::string prev() { return ""; }
-        inline void update(const std::string&, char) {}
+        template<typename Text>
+        inline void update(const Text&, char) {}
     };
 
     class allvk
@@ -0,0 +1,79 @@
+//
+// Copyright (c) 2007 Sami Visnen
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "config.h"
+
+#include "instrument.h"
+#include <atomic>
+#include <new>
+#include <cstdlib>
+
+namespace {
+    // these are zero initialized before any dynamic initialization
+    // so they are safe to use from allocations during static initialization.
+    std::atomic<unsigned long long> allocs;
+    std::atomic<unsigned long long> frees;
+    std::atomic<unsigned long long> bytes;
+} // namespace
+
+namespace cli
+{
+
+alloc_stats alloc_counters()
+{
+    alloc_stats ret = {
+        allocs.load(std::memory_order_relaxed),
+        frees.load(std::memory_order_relaxed),
+        bytes.load(std::memory_order_relaxed)
+    };
+    return ret;
+}
+
+bool alloc_instrumented()
+{
+    // any process allocates something before main so if the hook
+    // is installed the counter is not zero anymore.
+    return allocs.load(std::memory_order_relaxed) != 0;
+}
+
+void* instrument_alloc(std::size_t size)
+{
+    allocs.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(size, std::memory_order_relaxed);
+    void* ptr = std::malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void instrument_free(void* ptr)
+{
+    if (!ptr)
+        return;
+    frees.fetch_add(1, std::memory_order_relaxed);
+    std::free(ptr);
+}
+
+} // cli
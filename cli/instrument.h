@@ -0,0 +1,92 @@
+//
+// Copyright (c) 2007 Sami Visnen
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+#include "config.h"
+
+#include <cstddef>
+
+namespace cli
+{
+    // Allocation instrumentation. The library itself never replaces the
+    // global allocation functions. An application (or a test or a benchmark)
+    // opts in by putting CLI_INSTRUMENT_ALLOCATIONS() into exactly one of its
+    // translation units, after which every heap allocation in the process
+    // is counted. Without the hook all the counters stay at zero.
+    //
+    // The window records the allocations done by each draw, animate and keydown
+    // call, so a test can assert that a steady state frame doesn't allocate.
+
+    struct alloc_stats {
+        unsigned long long allocs;  // number of allocations
+        unsigned long long frees;   // number of deallocations
+        unsigned long long bytes;   // number of bytes allocated
+    };
+
+    inline
+    alloc_stats operator-(const alloc_stats& lhs, const alloc_stats& rhs)
+    {
+        alloc_stats ret = {lhs.allocs - rhs.allocs, lhs.frees - rhs.frees, lhs.bytes - rhs.bytes};
+        return ret;
+    }
+
+    // Get the allocation totals since the start of the process.
+    alloc_stats alloc_counters();
+
+    // Check whether the allocation hook is installed.
+    bool alloc_instrumented();
+
+    // Allocation functions used by the hook.
+    void* instrument_alloc(std::size_t bytes);
+    void  instrument_free(void* ptr);
+
+    // Records the allocations done during the lifetime of the
+    // scope object into the given stats.
+    class alloc_scope
+    {
+    public:
+        alloc_scope(alloc_stats& out) : out_(out), start_(alloc_counters()) {}
+       ~alloc_scope()
+        {
+            out_ = alloc_counters() - start_;
+        }
+    private:
+        alloc_scope(const alloc_scope&);
+        alloc_scope& operator=(const alloc_scope&);
+
+        alloc_stats& out_;
+        const alloc_stats start_;
+    };
+
+} // cli
+
+// Replace the global allocation functions with the counting ones.
+// Use at global scope in exactly one translation unit of the application.
+#define CLI_INSTRUMENT_ALLOCATIONS() \
+    void* operator new(std::size_t bytes) { return cli::instrument_alloc(bytes); } \
+    void* operator new[](std::size_t bytes) { return cli::instrument_alloc(bytes); } \
+    void operator delete(void* ptr) noexcept { cli::instrument_free(ptr); } \
+    void operator delete[](void* ptr) noexcept { cli::instrument_free(ptr); }
@@ -33,6 +33,7 @@
 #include "formatter.h"
 #include "ticker.h"
 #include "singlesel.h"
+#include "finder.h"
 #include <vector>
 #include <memory>
 #include <cassert>
@@ -56,9 +57,10 @@ namespace cli
     template <typename Database,
               typename Selector = default_single_selection,
               typename Ticker   = default_ticker,
-              typename Pager    = default_pager> 
+              typename Pager    = default_pager,
+              typename Finder   = default_finder> 
     class basic_list : public widget, 
-      public Database, public Selector, public Ticker, public Pager
+      public Database, public Selector, public Ticker, public Pager, public Finder
     {
     public:
         basic_list() : fill_(false), focus_(false), color_(COLOR_INACTIVE), width_(0), height_(0) {} 
@@ -80,9 +82,9 @@ namespace cli
             typedef typename Database::value     value;
             typedef typename Database::converter converter;
 
-            const cell def = {' ', ATTRIB_NONE, COLOR_NONE};       // default color
-            const cell sel = {' ', ATTRIB_NONE, COLOR_SELECTION};  // selection color when focused
-            const cell col = {' ', ATTRIB_NONE, color_};           // selection color when not focused
+            const cell def = {' ', ATTRIB_NONE, COLOR_NONE, 0, 0};       // default color
+            const cell sel = {' ', ATTRIB_NONE, COLOR_SELECTION, 0, 0};  // selection color when focused
+            const cell col = {' ', ATTRIB_NONE, color_, 0, 0};           // selection color when not focused
             formatter f(fb);
             f.setdef(def);
             f.setblank(def);
@@ -126,6 +128,13 @@ namespace cli
             return ret;
         }
 
+        int next_frame() const
+        {
+            if (!focus_ || Database::size() == 0)
+                return -1;
+            return Ticker::next_frame();
+        }
+
         rect animate(buffer& fb, int elapsed)
         {
             rect ret = {};
@@ -142,8 +151,8 @@ namespace cli
                 value val;
                 Database::fetch(val, row);
                 converter conv(val);
-                std::string str(conv.str(), conv.len());
-                Ticker::set(str, width_);
+                tickerline_.assign(conv.str(), conv.len());
+                Ticker::set(tickerline_, width_);
             }
             Ticker::scroll(fb, xpos_, ypos_ + pos);
             ret.top    = ypos_ + pos;
@@ -153,18 +162,19 @@ namespace cli
             return ret;
         }
 
-        bool keydown(int, int vk)
+        bool keydown(int raw, int vk)
         {
             bool invalid = false;
             if (Selector::keydown(vk, height_, Database::size(), invalid))
             {
                 if (invalid)
                     Pager::invalidate();
+                Finder::reset();
                 Ticker::reset();
                 valid_ = false;
                 return true;
             }
-            return false;
+            return find(raw, vk);
         }
 
         void invalidate(bool force)
@@ -223,11 +233,45 @@ namespace cli
             color_ = col;
         }
     private:
+        // Function object for the Finder to get the text of a row.
+        struct search_loader {
+            search_loader(basic_list* w) : widget_(w) {}
+            void operator()(int row, int col, std::string& str) const
+            {
+                typedef typename Database::value     value;
+                typedef typename Database::converter converter;
+                value val;
+                widget_->Database::fetch(val, row);
+                converter c(val);
+                str.assign(c.str(), c.len());
+            }
+            basic_list* widget_;
+        };
+
+        // Try to move the selection with the type-ahead search.
+        bool find(int raw, int vk)
+        {
+            int row = Selector::selpos();
+            if (!Finder::keydown(raw, vk, Database::size(), row, search_loader(this)))
+                return false;
+            if (row != Selector::selpos())
+            {
+                Selector::selpos(row);
+                if (Selector::evtrow)
+                    Selector::evtrow();
+            }
+            Pager::invalidate();
+            Ticker::reset();
+            valid_ = false;
+            return true;
+        }
+
         bool  fill_;
         bool  focus_;
         short color_;
         int   width_;
         int   height_;
+        std::string tickerline_;
     };
 
 } // cli
@@ -26,6 +26,8 @@
 #include "menu.h"
 #include "formatter.h"
 #include "buffer.h"
+#include "unicode.h"
+#include <algorithm>
 #include <cassert>
 
 using namespace std;
@@ -33,13 +35,25 @@ using namespace std;
 namespace 
 {
     enum { MENUSPACING = 1 };
+
+    int accel_key(int key)
+    {
+        if (key >= 'A' && key <= 'Z')
+            return key - 'A' + 'a';
+        return key;
+    }
+
+    int text_width(const std::string& str)
+    {
+        return static_cast<int>(cli::utf8_width(str.c_str(), str.size()));
+    }
 }
 
 namespace cli
 {
 
 menu::menu() : isopen_(false), erase_(false), menclindex_(0), itemindex_(0), 
-               width_(-1), height_(-1)
+               width_(-1), height_(-1), menuwidth_(0), maxrows_(0), rows_(0), top_(0), stale_(false)
 {
     memset(&eraserc_, 0, sizeof(rect));
 }
@@ -53,9 +67,9 @@ rect menu::draw(buffer& fb)
 {
     assert(valid_ == false);
 
-    cell sel = {' ', ATTRIB_NONE, COLOR_SELECTION};
-    cell def = {' ', ATTRIB_NONE, COLOR_MENUITEM};
-    cell sp  = {' ', ATTRIB_NONE, COLOR_NONE};
+    cell sel = {' ', ATTRIB_NONE, COLOR_SELECTION, 0, 0};
+    cell def = {' ', ATTRIB_NONE, COLOR_MENUITEM, 0, 0};
+    cell sp  = {' ', ATTRIB_NONE, COLOR_NONE, 0, 0};
     formatter f(def, fb);
     f.fillblank(true);
     
@@ -79,11 +93,12 @@ rect menu::draw(buffer& fb)
         if (isopen_ && menclindex_ == i)
             f.setdef(sel);
 
+        const metrics& m = metrics_[i];
         f.move(xpos, ypos_);
-        f.print(sub.text.c_str(), sub.text.size()); 
+        f.print(sub.text.c_str(), sub.text.size(), m.textwidth); 
         // print a space after a menu item
         f.setdef(sp);
-        f.move(xpos + sub.text.size(), ypos_);
+        f.move(xpos + m.textwidth, ypos_);
         f.print("", 1);
         if (isopen_ && menclindex_ == i && !sub.items.empty())
         {
@@ -91,23 +106,42 @@ rect menu::draw(buffer& fb)
             // menu is closed. therefore save the dropdown menu rectangle for later
             assert(rect_is_empty(eraserc_));
 
-            // find longest menu item string
-            int len = 0;
-            for (itemlist::size_type x(0); x<sub.items.size(); ++x)
-                len = std::max<int>(len, sub.items[x].text.size());
-            
-            // draw items
+            const int len   = m.itemwidth;
+            const itemlist::size_type rows = visible_rows(fb, static_cast<int>(sub.items.size()));
+
+            // scroll the selected item into view
+            if (itemindex_ < top_)
+                top_ = itemindex_;
+            else if (itemindex_ >= top_ + rows)
+                top_ = itemindex_ - rows + 1;
+            if (top_ + rows > sub.items.size())
+                top_ = sub.items.size() - rows;
+            rows_ = static_cast<int>(rows);
+
+            // save the cells under the drop down before drawing over them.
+            // if the drop down changed its size the saved cells no longer match.
+            // the saved area is clipped to the frame buffer, so compare clipped.
+            const rect area = save_under::clip(fb, make_rect(xpos, ypos_ + 1, len, static_cast<int>(rows)));
+            if (under_.is_saved() && memcmp(&under_.area(), &area, sizeof(rect)))
+            {
+                under_.discard();
+                stale_ = true;
+            }
+            if (!under_.is_saved() && !stale_)
+                under_.save(fb, area);
+
+            // draw the visible items
             int ypos = ypos_ + 1;
-            for (itemlist::size_type x(0); x<sub.items.size(); ++x, ++ypos)
+            for (itemlist::size_type x(top_); x<top_ + rows; ++x, ++ypos)
             {
                 const string& str = sub.items[x].text;
                 f.move(xpos, ypos);
                 f.setdef(def);
                 if (itemindex_ == x)
                     f.setdef(sel);
-                f.print(str.c_str(), len);
+                f.print(str.c_str(), str.size(), len);
             }
-            ret.bottom = ypos_ + ypos - 1;
+            ret.bottom = ypos;
             ret.right  = xpos + len; // xpos already includes left offset
             
             eraserc_.left   = xpos;
@@ -116,7 +150,7 @@ rect menu::draw(buffer& fb)
             eraserc_.bottom = ret.bottom;
         }
 
-        xpos += sub.text.size();
+        xpos += m.textwidth;
         if (i < menus_.size()-1)
             xpos += MENUSPACING;
     }
@@ -140,16 +174,47 @@ rect menu::erase()
     if (erase_)
     {
         erase_ = false;
+        stale_ = false;
+        under_.discard();
         return eraserc_;
     }
     rect rc = {};
     return rc;
 }
 
+rect menu::restore(buffer& fb)
+{
+    // the closed drop down is only restored before the menu redraws.
+    // without an erase handler the erase flag is never reset, so it 
+    // alone doesn't tell whether the open drop down is still shown.
+    rect rc = {};
+    if (!erase_ || valid_)
+        return rc;
+
+    // the drop down is gone, the next one saves its cells again.
+    // if the cells weren't saved the erase is left for erase().
+    stale_ = false;
+    if (!under_.is_saved())
+        return rc;
+    erase_ = false;
+    return under_.restore(fb);
+}
+
+void menu::overdrawn(const rect& rc)
+{
+    if (under_.is_saved() && rect_intersects_rect(under_.area(), rc))
+    {
+        under_.discard();
+        stale_ = true;
+    }
+}
+
 bool menu::keydown(int raw, int vk)
 {
-    if (menus_.empty() || vk == -1)
+    if (menus_.empty())
         return false;
+    if (vk == -1)
+        return isopen_ && accelerate(raw);
 
     assert(menclindex_ < menus_.size());
     
@@ -185,10 +250,33 @@ bool menu::keydown(int raw, int vk)
                 }
             }
             break;
+        case VK_MOVE_HOME:
+            if (isopen_ && !sub.items.empty())
+                select(0, true);
+            break;
+        case VK_MOVE_END:
+            if (isopen_ && !sub.items.empty())
+                select(sub.items.size()-1, false);
+            break;
+        case VK_MOVE_UP_PAGE:
+            if (isopen_ && !sub.items.empty())
+            {
+                const itemlist::size_type page = std::max(rows_, 1);
+                select(itemindex_ > page ? itemindex_ - page : 0, true);
+            }
+            break;
+        case VK_MOVE_DOWN_PAGE:
+            if (isopen_ && !sub.items.empty())
+            {
+                const itemlist::size_type page = std::max(rows_, 1);
+                select(std::min(itemindex_ + page, sub.items.size()-1), false);
+            }
+            break;
         case VK_MOVE_NEXT:
             // move to next submenu
             menclindex_ = (menclindex_ + 1) % menus_.size();
             itemindex_ = 0;
+            top_       = 0;
             erase_     = true;
             break;
         case VK_MOVE_PREV:
@@ -198,6 +286,7 @@ bool menu::keydown(int raw, int vk)
             else
                 menclindex_ = menus_.size()-1; // wrap over
             itemindex_ = 0;
+            top_       = 0;
             erase_     = true;
             break;
         case VK_ACTION_SPACE:
@@ -207,6 +296,7 @@ bool menu::keydown(int raw, int vk)
                 itemlist::size_type index  = itemindex_;
                 isopen_    = !isopen_;
                 itemindex_ = 0;
+                top_       = 0;
                 if (!isopen_)
                     erase_ = true;
                 if (!isopen_ && evtmenu)
@@ -228,16 +318,7 @@ int menu::width() const
         assert(isopen_ == false);
         // not a single call to to draw. width must be just the 
         // width of the top level menu items + cellspacings.
-        int width = 0;
-        for (menulist::size_type i(0); i<menus_.size(); ++i)
-        {
-            const submenu& sub = menus_[i];
-            width += sub.text.size();
-        }
-        if (!menus_.empty())
-            width += (menus_.size() - 1) * MENUSPACING;
-        
-        return width;
+        return menuwidth_;
     }
     return width_;
 }
@@ -261,6 +342,29 @@ void menu::setmenu(const menulist& list)
     isopen_ = false;
     itemindex_ = 0;
     menclindex_ = 0;
+    top_ = 0;
+
+    metrics_.clear();
+    metrics_.resize(menus_.size());
+    menuwidth_ = 0;
+    for (menulist::size_type i(0); i<menus_.size(); ++i)
+    {
+        const submenu& sub = menus_[i];
+        metrics& m = metrics_[i];
+        m.textwidth = text_width(sub.text);
+        m.itemwidth = 0;
+        for (itemlist::size_type x(0); x<sub.items.size(); ++x)
+        {
+            const menu_item& item = sub.items[x];
+            m.itemwidth = std::max(m.itemwidth, text_width(item.text));
+            // the first item with the key gets it
+            if (item.accel && !item.separator)
+                m.accels.insert(std::make_pair(accel_key(item.accel), x));
+        }
+        menuwidth_ += m.textwidth;
+    }
+    if (!menus_.empty())
+        menuwidth_ += (menus_.size() - 1) * MENUSPACING;
 }
 
 void menu::open(int submenu)
@@ -269,6 +373,7 @@ void menu::open(int submenu)
     assert(submenu < static_cast<int>(menus_.size()));
     menclindex_ = submenu;
     itemindex_ = 0;
+    top_       = 0;
     isopen_    = true;
     valid_     = false;
 }
@@ -281,6 +386,7 @@ void menu::close()
     erase_  = true;
     menclindex_ = 0;
     itemindex_ = 0;
+    top_       = 0;
 }
 
 bool menu::is_open() const
@@ -293,5 +399,58 @@ bool menu::is_empty() const
     return menus_.empty();
 }
 
+void menu::set_max_rows(int rows)
+{
+    assert(rows >= 0);
+    maxrows_ = rows;
+    valid_   = false;
+}
+
+int menu::visible_rows(const buffer& fb, int items) const
+{
+    int rows = items;
+    if (maxrows_ && rows > maxrows_)
+        rows = maxrows_;
+    // the drop down starts below the menu row.
+    const int space = static_cast<int>(fb.rows()) - ypos_ - 1;
+    if (rows > space)
+        rows = std::max(space, 1);
+    return rows;
+}
+
+void menu::select(itemlist::size_type index, bool forward)
+{
+    // land on the nearest item that is not a separator
+    const std::vector<menu_item>& items = menus_[menclindex_].items;
+    for (itemlist::size_type i(0); i<items.size(); ++i)
+    {
+        if (!items[index].separator)
+            break;
+        if (forward)
+            index = (index + 1) % items.size();
+        else
+            index = index > 0 ? index - 1 : items.size()-1;
+    }
+    itemindex_ = index;
+}
+
+bool menu::accelerate(int raw)
+{
+    const metrics& m = metrics_[menclindex_];
+    std::unordered_map<int, itemlist::size_type>::const_iterator it = m.accels.find(accel_key(raw));
+    if (it == m.accels.end())
+        return false;
+
+    const menu_item& item = menus_[menclindex_].items[it->second];
+    isopen_    = false;
+    itemindex_ = 0;
+    top_       = 0;
+    erase_     = true;
+    valid_     = false;
+    if (evtmenu)
+        evtmenu(item.id);
+    return true;
+}
+
 } // cli
 
@@ -30,9 +30,11 @@
 #include "formatter.h"
 #include "widget.h"
 #include "common.h"
+#include "saveunder.h"
 #include <vector>
 #include <string>
 #include <functional>
+#include <unordered_map>
 
 namespace cli
 {
@@ -40,12 +42,13 @@ namespace cli
         std::string text;
         int  id;
         bool separator;
+        int  accel;     // accelerator key, 0 for none
     };
 
     inline
-    menu_item make_menu_item(const std::string& text, int id=0, bool sep=false)
+    menu_item make_menu_item(const std::string& text, int id=0, bool sep=false, int accel=0)
     {
-        menu_item m = {text, id, sep};
+        menu_item m = {text, id, sep, accel};
         return m;
     }
     
@@ -58,6 +61,16 @@ namespace cli
     typedef std::vector<submenu> menulist;
     typedef std::vector<std::string> itemlist;
 
+    // A menu bar with drop down submenus. The item widths and the
+    // accelerator keys are computed once in setmenu(). A submenu with more
+    // items than fit on the screen (or than set_max_rows() allows) shows
+    // a scrolling window of the items around the selected item.
+    // Pressing an accelerator key while a submenu is open selects the item.
+    //
+    // The cells underneath an open submenu are saved when it is first drawn
+    // and put back when it closes. If other widgets draw under the submenu
+    // while it is open the saved cells are dropped and closing the submenu
+    // erases the area instead.
     class menu : public widget
     {
     public:
@@ -80,6 +93,12 @@ namespace cli
         // item has been closed.
         rect erase();
 
+        // Put back the cells under a closed submenu.
+        rect restore(buffer& fb);
+
+        // Drop the saved cells if they've been drawn over.
+        void overdrawn(const rect& rc);
+
         // Process keydown event.
         bool keydown(int raw, int vk);
 
@@ -102,7 +121,21 @@ namespace cli
         bool is_open() const;
         bool is_empty() const;
 
+        // Limit the number of items visible at once in a submenu.
+        // 0 means no limit other than the screen height.
+        void set_max_rows(int rows);
+
     private:
+        struct metrics {
+            int textwidth;   // width of the submenu title
+            int itemwidth;   // width of the widest item
+            std::unordered_map<int, itemlist::size_type> accels;
+        };
+
+        int visible_rows(const buffer& fb, int items) const;
+        void select(itemlist::size_type index, bool forward);
+        bool accelerate(int raw);
+
         bool isopen_;                    // flag telling if there is a menu open or not
         bool erase_;                     // flag telling if we have something to erase
         menulist menus_;                 // the list of menus      
@@ -111,6 +144,13 @@ namespace cli
         rect eraserc_;                   // the rectangle that needs erasing
         int  width_;                     // width of the current menu rectangle (open or closed)
         int  height_;                    // height of the current menu rectangle (open or closed)
+        std::vector<metrics> metrics_;   // cached metrics of each submenu
+        int  menuwidth_;                 // width of the top level items
+        int  maxrows_;                   // max visible submenu items, 0 for no limit
+        int  rows_;                      // number of submenu items visible in the last draw
+        itemlist::size_type top_;        // first visible submenu item
+        save_under under_;               // the cells under the open submenu
+        bool stale_;                     // the cells under the open submenu were drawn over
     };
     
 
@@ -44,8 +44,8 @@ namespace cli
         
         rect draw(buffer& fb)
         {
-            cell text = {' ', ATTRIB_NONE, COLOR_NONE};
-            cell fill = {'=', ATTRIB_NONE, COLOR_NONE};
+            cell text = {' ', ATTRIB_NONE, COLOR_NONE, 0, 0};
+            cell fill = {'=', ATTRIB_NONE, COLOR_NONE, 0, 0};
             formatter f(text, fb);
             f.move(xpos_, ypos_);
             f.print("[", width_);
@@ -0,0 +1,427 @@
+//
+// Copyright (c) 2007 Sami Väisänen
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+#include "config.h"
+
+#include "common.h"
+#include <map>
+#include <iterator>
+#include <functional>
+#include <algorithm>
+#include <cassert>
+
+namespace cli
+{
+    // Row_set is a set of rows stored as sorted, disjoint and
+    // non-adjacent half open intervals [start, end). Operations cost
+    // O(log k) where k is the number of intervals, regardless of how many
+    // rows the intervals cover.
+    class row_set
+    {
+    public:
+        typedef std::map<int, int> interval_map;
+
+        // Iterates over every single row in the set in ascending order.
+        class const_iterator : public std::iterator<std::forward_iterator_tag, int>
+        {
+        public:
+            const_iterator() : row_(0) {}
+            const_iterator(interval_map::const_iterator it, interval_map::const_iterator end)
+                : it_(it), end_(end), row_(it == end ? 0 : it->first)
+            {}
+            int operator*() const
+            {
+                return row_;
+            }
+            const_iterator& operator++()
+            {
+                if (++row_ == it_->second)
+                {
+                    if (++it_ != end_)
+                        row_ = it_->first;
+                    else
+                        row_ = 0;
+                }
+                return *this;
+            }
+            const_iterator operator++(int)
+            {
+                const_iterator tmp(*this);
+                ++(*this);
+                return tmp;
+            }
+            bool operator==(const const_iterator& other) const
+            {
+                return it_ == other.it_ && row_ == other.row_;
+            }
+            bool operator!=(const const_iterator& other) const
+            {
+                return !(*this == other);
+            }
+        private:
+            interval_map::const_iterator it_;
+            interval_map::const_iterator end_;
+            int row_;
+        };
+
+        row_set() : count_(0) {}
+
+        // Add rows [first, last) into the set.
+        void add(int first, int last)
+        {
+            if (first >= last)
+                return;
+
+            // find the first interval that could touch [first, last)
+            interval_map::iterator it = set_.upper_bound(first);
+            if (it != set_.begin())
+            {
+                interval_map::iterator prev = it;
+                --prev;
+                if (prev->second >= first)
+                    it = prev;
+            }
+            // swallow all intervals that overlap or are adjacent
+            while (it != set_.end() && it->first <= last)
+            {
+                first  = std::min(first, it->first);
+                last   = std::max(last, it->second);
+                count_ -= it->second - it->first;
+                set_.erase(it++);
+            }
+            set_.insert(it, std::make_pair(first, last));
+            count_ += last - first;
+        }
+
+        // Remove rows [first, last) from the set.
+        void remove(int first, int last)
+        {
+            if (first >= last)
+                return;
+
+            interval_map::iterator it = set_.upper_bound(first);
+            if (it != set_.begin())
+            {
+                interval_map::iterator prev = it;
+                --prev;
+                if (prev->second > first)
+                    it = prev;
+            }
+            while (it != set_.end() && it->first < last)
+            {
+                const int start = it->first;
+                const int end   = it->second;
+                count_ -= end - start;
+                set_.erase(it++);
+                // keep whatever sticks out on either side
+                if (start < first)
+                {
+                    set_.insert(std::make_pair(start, first));
+                    count_ += first - start;
+                }
+                if (end > last)
+                {
+                    it = set_.insert(it, std::make_pair(last, end));
+                    count_ += end - last;
+                    break;
+                }
+            }
+        }
+
+        // Toggle a single row.
+        void toggle(int row)
+        {
+            if (contains(row))
+                remove(row, row + 1);
+            else
+                add(row, row + 1);
+        }
+
+        // Invert the set within the rows [0, max). Any rows
+        // outside of this range are dropped.
+        void invert(int max)
+        {
+            interval_map inv;
+            int count = 0;
+            int start = 0;
+            for (interval_map::const_iterator it = set_.begin(); it != set_.end(); ++it)
+            {
+                if (it->first >= max)
+                    break;
+                if (it->first > start)
+                {
+                    inv.insert(inv.end(), std::make_pair(start, it->first));
+                    count += it->first - start;
+                }
+                start = std::max(start, it->second);
+            }
+            if (start < max)
+            {
+                inv.insert(inv.end(), std::make_pair(start, max));
+                count += max - start;
+            }
+            set_.swap(inv);
+            count_ = count;
+        }
+
+        void clear()
+        {
+            set_.clear();
+            count_ = 0;
+        }
+
+        bool contains(int row) const
+        {
+            interval_map::const_iterator it = set_.upper_bound(row);
+            if (it == set_.begin())
+                return false;
+            --it;
+            return row < it->second;
+        }
+
+        // Get the number of rows in the set.
+        int count() const
+        {
+            return count_;
+        }
+
+        bool empty() const
+        {
+            return count_ == 0;
+        }
+
+        // Get the underlying intervals. Useful for bulk
+        // operations that can work on whole ranges at once.
+        const interval_map& intervals() const
+        {
+            return set_;
+        }
+
+        const_iterator begin() const
+        {
+            return const_iterator(set_.begin(), set_.end());
+        }
+        const_iterator end() const
+        {
+            return const_iterator(set_.end(), set_.end());
+        }
+    private:
+        interval_map set_;
+        int count_;
+    };
+
+
+    // Implements selection of any number of arbitrary rows.
+    // Rows can be marked one at a time or as a rubberband. VK_SET_MARK
+    // starts a rubberband at the current row and the next VK_SET_MARK
+    // toggles all rows covered by the rubberband. The marked rows
+    // are kept in a row_set so checking whether a row is selected
+    // stays cheap no matter how many rows are marked.
+    class multi_range_selection
+    {
+    public:
+        enum { MARK_NOT_SET = -1 };
+
+        typedef row_set::const_iterator row_iterator;
+
+        // Fired when selection key is pressed.
+        std::function<void (void)> evtselect;
+
+        // Fired when selected row changes.
+        std::function<void (void)> evtrow;
+
+        void selpos(int pos)
+        {
+            row_ = pos;
+        }
+
+        // Return the current selection position.
+        int selpos() const
+        {
+            return row_;
+        }
+
+        // Mark rows [first, last).
+        void seladd(int first, int last)
+        {
+            rows_.add(first, last);
+        }
+
+        // Unmark rows [first, last).
+        void selrem(int first, int last)
+        {
+            rows_.remove(first, last);
+        }
+
+        // Toggle the mark on a single row.
+        void seltoggle(int row)
+        {
+            rows_.toggle(row);
+        }
+
+        // Invert the marked rows. Max should be the number of rows.
+        void selinvert(int max)
+        {
+            rows_.invert(max);
+        }
+
+        // Unmark all rows and drop any rubberband.
+        void selclear()
+        {
+            rows_.clear();
+            mark_ = MARK_NOT_SET;
+        }
+
+        // Get the number of marked rows.
+        int selcount() const
+        {
+            return rows_.count();
+        }
+
+        // Iterate over the marked rows.
+        row_iterator selbegin() const
+        {
+            return rows_.begin();
+        }
+        row_iterator selend() const
+        {
+            return rows_.end();
+        }
+
+        // Get the marked rows.
+        const row_set& selection() const
+        {
+            return rows_;
+        }
+    protected:
+       ~multi_range_selection() {}
+        multi_range_selection() : row_(0), mark_(MARK_NOT_SET) {}
+
+        bool keydown(int vk, int page_height, int max, bool& invalid)
+        {
+            if (max == 0 || page_height == 0)
+                return false;
+
+            invalid = false;
+            int old = row_;
+            switch (vk)
+            {
+                case VK_MOVE_UP:
+                    if (row_ > 0)
+                        --row_;
+                    break;
+
+                case VK_MOVE_DOWN:
+                    if (row_ < max - 1)
+                        ++row_;
+                    break;
+
+                case VK_MOVE_HOME:
+                    row_ = 0;
+                    break;
+
+                case VK_MOVE_END:
+                    row_ = max - 1;
+                    break;
+
+                case VK_MOVE_UP_PAGE:
+                    row_ -= page_height;
+                    if (row_ < 0)
+                        row_ = 0;
+                    break;
+
+                case VK_MOVE_DOWN_PAGE:
+                    row_ += page_height;
+                    if (row_ >= max)
+                        row_ = max - 1;
+                    break;
+
+                case VK_SET_MARK:
+                    if (mark_ == MARK_NOT_SET)
+                    {
+                        mark_ = row_;
+                        break;
+                    }
+                    if (mark_ == row_)
+                    {
+                        rows_.toggle(row_);
+                    }
+                    else
+                    {
+                        // the rubberband marks or unmarks the whole range
+                        // depending on the state of the row where it started.
+                        const int first = std::min(row_, mark_);
+                        const int last  = std::max(row_, mark_) + 1;
+                        if (rows_.contains(mark_))
+                            rows_.remove(first, last);
+                        else
+                            rows_.add(first, last);
+                    }
+                    mark_   = MARK_NOT_SET;
+                    invalid = true;
+                    break;
+
+                case VK_ACTION_SPACE:
+                case VK_ACTION_ENTER:
+                    if (evtselect)
+                        evtselect();
+                    return false;
+
+                default:
+                    return false;
+            }
+            if (old != row_ && evtrow)
+                evtrow();
+
+            return true;
+        }
+
+        bool is_selected(int row) const
+        {
+            if (row == row_)
+                return true;
+            if (mark_ != MARK_NOT_SET)
+            {
+                if (row >= std::min(row_, mark_) && row <= std::max(row_, mark_))
+                    return true;
+            }
+            return rows_.contains(row);
+        }
+
+        bool reset()
+        {
+            mark_ = MARK_NOT_SET;
+            return true;
+        }
+
+    private:
+        int row_;
+        int mark_;
+        row_set rows_;
+    };
+
+} // cli
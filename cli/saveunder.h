@@ -0,0 +1,119 @@
+//
+// Copyright (c) 2007 Sami Visnen
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "config.h"
+
+#include "common.h"
+#include "buffer.h"
+#include <vector>
+#include <algorithm>
+#include <cassert>
+
+namespace cli
+{
+    // Save_under is a backing store for the frame buffer cells underneath
+    // a popup. The popup saves the area before drawing itself over it and
+    // puts the cells back when it closes, so the widgets underneath don't
+    // need to be redrawn. 
+    class save_under
+    {
+    public:
+        save_under() : area_() {}
+
+        // Save the cells inside the rectangle. The rectangle is 
+        // clipped to the frame buffer.
+        void save(const buffer& fb, const rect& rc)
+        {
+            area_ = clip(fb, rc);
+            if (area_.right <= area_.left || area_.bottom <= area_.top)
+            {
+                discard();
+                return;
+            }
+            const int width = area_.right - area_.left;
+            cells_.resize(width * (area_.bottom - area_.top));
+            std::vector<cell>::iterator out = cells_.begin();
+            for (int y=area_.top; y<area_.bottom; ++y, out += width)
+            {
+                const buffer::row_type& row = fb[y];
+                std::copy(row.begin() + area_.left, row.begin() + area_.right, out);
+            }
+        }
+
+        // Copy the saved cells back into the frame buffer and drop them.
+        // Returns the restored rectangle.
+        rect restore(buffer& fb)
+        {
+            const rect rc = area_;
+            if (rect_is_empty(rc))
+                return rc;
+            assert(rc.bottom <= static_cast<int>(fb.rows()));
+            assert(rc.right <= static_cast<int>(fb.cols()));
+
+            const int width = rc.right - rc.left;
+            std::vector<cell>::const_iterator in = cells_.begin();
+            for (int y=rc.top; y<rc.bottom; ++y, in += width)
+                std::copy(in, in + width, fb[y].begin() + rc.left);
+            discard();
+            return rc;
+        }
+
+        // Drop the saved cells. The capacity is kept for the next save.
+        void discard()
+        {
+            rect rc = {};
+            area_ = rc;
+        }
+
+        bool is_saved() const
+        {
+            return !rect_is_empty(area_);
+        }
+
+        // Get the saved area.
+        const rect& area() const
+        {
+            return area_;
+        }
+
+        // Clip the rectangle to the frame buffer the way save does.
+        static rect clip(const buffer& fb, const rect& rc)
+        {
+            rect ret;
+            ret.left   = std::max(rc.left, 0);
+            ret.top    = std::max(rc.top, 0);
+            ret.right  = std::min<int>(rc.right, static_cast<int>(fb.cols()));
+            ret.bottom = std::min<int>(rc.bottom, static_cast<int>(fb.rows()));
+            return ret;
+        }
+    private:
+        std::vector<cell> cells_;
+        rect area_;
+    };
+
+} // cli
@@ -0,0 +1,252 @@
+//
+// Copyright (c) 2007 Sami Visnen
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "config.h"
+
+#include "session.h"
+#include "varint.h"
+#include "window.h"
+#include "buffer.h"
+#include <stdexcept>
+#include <algorithm>
+#include <functional>
+
+namespace {
+    const char MAGIC[4] = {'C', 'L', 'I', 'S'};
+    const unsigned VERSION = 2;
+
+    // sanity limit for the length of a pasted text.
+    const int MAX_PASTE = 1 << 24;
+
+    bool rect_equal(const cli::rect& lhs, const cli::rect& rhs)
+    {
+        return lhs.top == rhs.top && lhs.left == rhs.left &&
+            lhs.right == rhs.right && lhs.bottom == rhs.bottom;
+    }
+
+    void replay_draw(cli::window* wnd, cli::buffer* fb, cli::rect* damage)
+    {
+        *damage = cli::rect_union(*damage, wnd->draw(*fb));
+    }
+
+    void count_frame(cli::replay_report& report, const cli::rect& rc)
+    {
+        if (cli::rect_is_empty(rc))
+            return;
+        ++report.frames;
+        report.replayed_cells += (rc.right - rc.left) * (rc.bottom - rc.top);
+    }
+
+} // namespace
+
+namespace cli
+{
+
+session_writer::session_writer(std::ostream& out, const size& screen) : out_(out), last_(std::chrono::steady_clock::now())
+{
+    out_.write(MAGIC, sizeof(MAGIC));
+    write_varint(out_, VERSION);
+    write_varint(out_, screen.cols);
+    write_varint(out_, screen.rows);
+}
+
+void session_writer::key(int raw, int vk)
+{
+    session_event e = {};
+    e.type   = SESSION_KEY;
+    e.millis = elapsed();
+    e.raw    = raw;
+    e.vk     = vk;
+    write(e);
+}
+
+void session_writer::frame(const rect& rc, int bytes)
+{
+    session_event e = {};
+    e.type   = SESSION_FRAME;
+    e.millis = elapsed();
+    e.rc     = rc;
+    e.bytes  = bytes;
+    write(e);
+}
+
+void session_writer::paste(const std::string& text)
+{
+    session_event e = {};
+    e.type   = SESSION_PASTE;
+    e.millis = elapsed();
+    e.text   = text;
+    write(e);
+}
+
+void session_writer::write(const session_event& e)
+{
+    out_.put(static_cast<char>(e.type));
+    write_varint(out_, e.millis);
+    if (e.type == SESSION_KEY)
+    {
+        write_svarint(out_, e.raw);
+        write_svarint(out_, e.vk);
+    }
+    else if (e.type == SESSION_PASTE)
+    {
+        write_varint(out_, e.text.size());
+        out_.write(e.text.data(), e.text.size());
+    }
+    else
+    {
+        write_varint(out_, e.rc.top);
+        write_varint(out_, e.rc.left);
+        write_varint(out_, e.rc.right);
+        write_varint(out_, e.rc.bottom);
+        write_varint(out_, e.bytes);
+    }
+}
+
+int session_writer::elapsed()
+{
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    const int ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(now - last_).count());
+    last_ = now;
+    return ms;
+}
+
+session_reader::session_reader(std::istream& in) : in_(in)
+{
+    char magic[4] = {};
+    in_.read(magic, sizeof(magic));
+    unsigned long long version = 0;
+    if (!in_ || !std::equal(magic, magic + 4, MAGIC) || !read_varint(in_, version))
+        throw std::runtime_error("not a session recording");
+    // version 1 sessions have no pastes.
+    if (version < 1 || version > VERSION)
+        throw std::runtime_error("unsupported session version");
+    if (!read_varint(in_, screen_.cols) || !read_varint(in_, screen_.rows))
+        throw std::runtime_error("truncated session header");
+}
+
+bool session_reader::next(session_event& e)
+{
+    const int type = in_.get();
+    if (type != SESSION_KEY && type != SESSION_FRAME && type != SESSION_PASTE)
+        return false;
+
+    e = session_event();
+    e.type = type;
+    if (!read_varint(in_, e.millis))
+        return false;
+    if (type == SESSION_KEY)
+        return read_svarint(in_, e.raw) && read_svarint(in_, e.vk);
+    if (type == SESSION_PASTE)
+    {
+        int len = 0;
+        if (!read_varint(in_, len) || len < 0 || len > MAX_PASTE)
+            return false;
+        e.text.resize(len);
+        if (len)
+            in_.read(&e.text[0], len);
+        return !!in_;
+    }
+
+    return read_varint(in_, e.rc.top) && read_varint(in_, e.rc.left) &&
+        read_varint(in_, e.rc.right) && read_varint(in_, e.rc.bottom) &&
+        read_varint(in_, e.bytes);
+}
+
+replay_report session_replay(session_reader& session, window& wnd, buffer& fb)
+{
+    replay_report report;
+    report.keys            = 0;
+    report.pastes          = 0;
+    report.frames          = 0;
+    report.recorded_frames = 0;
+    report.mismatches      = 0;
+    report.recorded_bytes  = 0;
+    report.replayed_cells  = 0;
+
+    rect damage = {};
+    std::function<void(window*)> evtdraw = wnd.evtdraw;
+    wnd.evtdraw = std::bind(replay_draw, std::placeholders::_1, &fb, &damage);
+
+    if (!wnd.is_valid())
+        wnd.draw(fb);
+
+    // every event advances the window clock by its recorded time so the
+    // animations run at the same times as in the recording. the frames
+    // recorded between a key or a paste and the next one are combined and
+    // compared against the damage of the replayed input plus the animation
+    // frames replayed in the same interval.
+    rect recorded = {};
+    rect replayed = {};
+    bool pending  = false;
+    session_event e;
+    while (session.next(e))
+    {
+        if (e.type == SESSION_FRAME)
+        {
+            const rect animated = wnd.animate(fb, e.millis);
+            count_frame(report, animated);
+            replayed = rect_union(replayed, animated);
+            recorded = rect_union(recorded, e.rc);
+            report.recorded_bytes += e.bytes;
+            ++report.recorded_frames;
+            continue;
+        }
+
+        // animations due before the input belong to the previous input.
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        const rect animated = wnd.animate(fb, e.millis);
+        count_frame(report, animated);
+        replayed = rect_union(replayed, animated);
+        if (pending && !rect_equal(recorded, replayed))
+            ++report.mismatches;
+
+        damage = make_rect(0, 0, 0, 0);
+        if (e.type == SESSION_PASTE)
+            wnd.paste(e.text.data(), e.text.size());
+        else
+            wnd.keydown(e.raw, e.vk);
+        if (!wnd.is_valid())
+            damage = rect_union(damage, wnd.draw(fb));
+        const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+        report.frame_us.push_back(static_cast<int>(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count()));
+        if (e.type == SESSION_PASTE)
+            ++report.pastes;
+        else
+            ++report.keys;
+        count_frame(report, damage);
+        replayed = damage;
+        recorded = make_rect(0, 0, 0, 0);
+        pending  = true;
+    }
+    if (pending && !rect_equal(recorded, replayed))
+        ++report.mismatches;
+
+    wnd.evtdraw = evtdraw;
+    return report;
+}
+
+} // cli
@@ -0,0 +1,136 @@
+//
+// Copyright (c) 2007 Sami Visnen
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+#include "config.h"
+
+#include <istream>
+#include <ostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include "common.h"
+
+namespace cli
+{
+    class window;
+    class buffer;
+
+    // Session recording. A session is a log of the input keys given to a window
+    // and the damage rectangles of the frames drawn as a response, each stamped
+    // with the time in milliseconds since the previous event. Since the library
+    // takes all input through window::keydown and renders into an abstract buffer
+    // a session can be replayed headless and deterministically against a new
+    // build to compare the output and measure the frame times.
+    //
+    // The file format is a small header followed by the events.
+    // header: "CLIS" version cols rows
+    // key   : 1 millis raw vk
+    // frame : 2 millis top left right bottom bytes
+    // paste : 3 millis length text
+    // All the numbers are varints, raw and vk are signed.
+
+    enum session_event_type {
+        SESSION_KEY   = 1,
+        SESSION_FRAME = 2,
+        SESSION_PASTE = 3
+    };
+
+    struct session_event {
+        int  type;    // session_event_type
+        int  millis;  // time since the previous event
+        int  raw;     // key events
+        int  vk;
+        rect rc;      // frame events, the damage rectangle
+        int  bytes;   // frame events, the bytes output by the terminal backend
+        std::string text; // paste events, the pasted text
+    };
+
+    // Writes a session into a stream.
+    class session_writer
+    {
+    public:
+        session_writer(std::ostream& out, const size& screen);
+
+        // Record a key press. The time is measured from the previous event.
+        void key(int raw, int vk);
+
+        // Record a drawn frame. The time is measured from the previous event.
+        void frame(const rect& rc, int bytes);
+
+        // Record pasted text. The time is measured from the previous event.
+        void paste(const std::string& text);
+
+        // Write an event with an explicit time stamp.
+        void write(const session_event& e);
+    private:
+        int elapsed();
+
+        std::ostream& out_;
+        std::chrono::steady_clock::time_point last_;
+    };
+
+    // Reads a session from a stream.
+    class session_reader
+    {
+    public:
+        // Reads the header. Throws std::runtime_error if the stream is not a session.
+        session_reader(std::istream& in);
+
+        // Get the screen size the session was recorded with.
+        const size& screen() const
+        {
+            return screen_;
+        }
+
+        // Read the next event. Returns false at the end of the session.
+        bool next(session_event& e);
+    private:
+        std::istream& in_;
+        size screen_;
+    };
+
+    // Results of a replay.
+    struct replay_report {
+        int keys;                   // number of keys replayed
+        int pastes;                 // number of pastes replayed
+        int frames;                 // number of frames drawn in the replay
+        int recorded_frames;        // number of frames in the recording
+        int mismatches;             // keys and pastes whose recorded damage differs from the replayed damage
+        long long recorded_bytes;   // bytes output in the recording
+        long long replayed_cells;   // cells damaged in the replay
+        std::vector<int> frame_us;  // time to process each key and paste, including animate and draw
+    };
+
+    // Replay a session into a window as fast as possible. The window draws into
+    // the given buffer, the window's evtdraw is replaced for the duration of 
+    // the replay. The time stamps of all the recorded events are passed to 
+    // window::animate so animations run at the times they did when the session
+    // was recorded. The damage of a key or a paste is compared against the frames
+    // recorded between it and the next input, animation frames included.
+    replay_report session_replay(session_reader& session, window& wnd, buffer& fb);
+
+} // cli
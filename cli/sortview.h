@@ -0,0 +1,622 @@
+//
+// Copyright (c) 2007 Sami Väisänen
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+#include "config.h"
+
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <cstring>
+#include <cassert>
+
+namespace cli
+{
+    // Sort key for a single row. For integer columns key is the
+    // integer value mapped to an unsigned value that sorts in the same order.
+    // For string columns key is the first 8 bytes of the string packed in
+    // big endian order so that most comparisons never touch the actual string.
+    struct sort_key {
+        unsigned long long key;
+        int row;
+    };
+
+    // Column sort keys. Computed once per column and then reused
+    // for every sort on that column until the data changes.
+    struct sort_column_keys {
+        bool numeric;
+        std::vector<unsigned long long> keys;  // indexed by source row
+        std::vector<std::string> strings;      // indexed by source row, string columns only
+    };
+
+    // Map a signed integer to an unsigned integer with the same ordering.
+    inline
+    unsigned long long sort_key_int(long long value)
+    {
+        return static_cast<unsigned long long>(value) ^ (1ull << 63);
+    }
+
+    // Pack the first 8 bytes of a string into an integer with the same ordering.
+    inline
+    unsigned long long sort_key_prefix(const char* str, std::size_t len)
+    {
+        unsigned long long key = 0;
+        for (std::size_t i=0; i<8; ++i)
+        {
+            key <<= 8;
+            if (i < len)
+                key |= static_cast<unsigned char>(str[i]);
+        }
+        return key;
+    }
+
+    // Stable LSD radix sort on the keys [first, last). Tmp must have room for
+    // as many keys. Passes where every key has the same digit are skipped,
+    // so small integers only cost a couple of passes.
+    inline
+    void sort_radix(sort_key* first, sort_key* last, sort_key* tmp)
+    {
+        const std::size_t n = last - first;
+        if (n < 2)
+            return;
+
+        sort_key* src = first;
+        sort_key* dst = tmp;
+        for (int shift=0; shift<64; shift+=8)
+        {
+            std::size_t count[256] = {};
+            for (std::size_t i=0; i<n; ++i)
+                ++count[(src[i].key >> shift) & 0xff];
+            if (count[(src[0].key >> shift) & 0xff] == n)
+                continue;
+
+            std::size_t pos = 0;
+            for (int i=0; i<256; ++i)
+            {
+                const std::size_t c = count[i];
+                count[i] = pos;
+                pos += c;
+            }
+            for (std::size_t i=0; i<n; ++i)
+                dst[count[(src[i].key >> shift) & 0xff]++] = src[i];
+            std::swap(src, dst);
+        }
+        if (src != first)
+            std::copy(src, src + n, first);
+    }
+
+    inline
+    void sort_radix(std::vector<sort_key>& keys, std::vector<sort_key>& tmp)
+    {
+        tmp.resize(keys.size());
+        if (keys.empty())
+            return;
+        sort_radix(&keys[0], &keys[0] + keys.size(), &tmp[0]);
+    }
+
+    // Compare rows by the integer key only.
+    struct sort_key_less {
+        bool operator()(const sort_key& lhs, const sort_key& rhs) const
+        {
+            return lhs.key < rhs.key;
+        }
+    };
+
+    // Compare rows by the string column keys.
+    class sort_string_less
+    {
+    public:
+        sort_string_less(const sort_column_keys& col, bool ascending) : col_(col), ascending_(ascending)
+        {}
+        bool operator()(const sort_key& lhs, const sort_key& rhs) const
+        {
+            return ascending_ ? less(lhs, rhs) : less(rhs, lhs);
+        }
+        bool less(const sort_key& lhs, const sort_key& rhs) const
+        {
+            if (lhs.key != rhs.key)
+                return lhs.key < rhs.key;
+            return col_.strings[lhs.row] < col_.strings[rhs.row];
+        }
+    private:
+        const sort_column_keys& col_;
+        const bool ascending_;
+    };
+
+    // Chunk sort functions for sort_parallel.
+    struct sort_chunk_radix {
+        void operator()(sort_key* first, sort_key* last, sort_key* tmp) const
+        {
+            sort_radix(first, last, tmp);
+        }
+    };
+
+    template<typename Less>
+    struct sort_chunk_stable {
+        sort_chunk_stable(const Less& less) : less_(less) {}
+        void operator()(sort_key* first, sort_key* last, sort_key*) const
+        {
+            std::stable_sort(first, last, less_);
+        }
+        Less less_;
+    };
+
+    // Below this many keys sort_parallel sorts on the calling thread only.
+    enum { SORT_PARALLEL_MIN = 1 << 15 };
+
+    // Get the number of threads to use for sorting.
+    inline
+    unsigned sort_threads()
+    {
+        const unsigned n = std::thread::hardware_concurrency();
+        return n ? n : 1;
+    }
+
+    namespace detail {
+        template<typename Sort>
+        void sort_parallel_chunk(Sort sort, sort_key* first, sort_key* last, sort_key* tmp)
+        {
+            sort(first, last, tmp);
+        }
+
+        template<typename Less>
+        void sort_parallel_merge(Less less, const sort_key* first, const sort_key* mid, const sort_key* last, sort_key* out)
+        {
+            std::merge(first, mid, mid, last, out, less);
+        }
+    } // detail
+
+    // Stable parallel merge sort. The keys are split into one chunk per thread,
+    // each chunk is sorted with sort(first, last, tmp) on its own thread and
+    // then the sorted runs are merged pairwise, each merge on its own thread,
+    // until a single run remains. Tmp is used as the merge target and the
+    // scratch space for the chunk sorts.
+    // Returns false if cancel was set before the sort was finished, in
+    // which case the contents of keys are unspecified.
+    template<typename Sort, typename Less>
+    bool sort_parallel(std::vector<sort_key>& keys, std::vector<sort_key>& tmp, Sort sort, Less less,
+        unsigned threads, const std::atomic<bool>* cancel = NULL)
+    {
+        const std::size_t n = keys.size();
+        tmp.resize(n);
+        if (n < 2)
+            return true;
+        if (threads < 2 || n < SORT_PARALLEL_MIN)
+        {
+            sort(&keys[0], &keys[0] + n, &tmp[0]);
+            return true;
+        }
+
+        std::vector<std::size_t> runs;
+        for (unsigned i=0; i<=threads; ++i)
+            runs.push_back(n * i / threads);
+
+        std::vector<std::thread> workers;
+        for (unsigned i=0; i<threads; ++i)
+        {
+            workers.push_back(std::thread(detail::sort_parallel_chunk<Sort>, sort,
+                &keys[runs[i]], &keys[0] + runs[i+1], &tmp[runs[i]]));
+        }
+        for (std::size_t i=0; i<workers.size(); ++i)
+            workers[i].join();
+
+        while (runs.size() > 2)
+        {
+            if (cancel && *cancel)
+                return false;
+
+            std::vector<std::size_t> next;
+            workers.clear();
+            std::size_t i = 0;
+            for (; i + 2 < runs.size(); i += 2)
+            {
+                workers.push_back(std::thread(detail::sort_parallel_merge<Less>, less,
+                    &keys[runs[i]], &keys[runs[i+1]], &keys[0] + runs[i+2], &tmp[runs[i]]));
+                next.push_back(runs[i]);
+            }
+            // odd run out is carried over as is
+            if (i + 1 < runs.size())
+            {
+                std::copy(keys.begin() + runs[i], keys.end(), tmp.begin() + runs[i]);
+                next.push_back(runs[i]);
+            }
+            next.push_back(n);
+
+            for (std::size_t w=0; w<workers.size(); ++w)
+                workers[w].join();
+            keys.swap(tmp);
+            runs.swap(next);
+        }
+        return true;
+    }
+
+    // Sort the rows in perm by the column keys. The sort is stable
+    // relative to the order in perm. Keys and tmp are scratch space.
+    inline
+    bool sort_rows(const sort_column_keys& col, bool ascending, std::vector<int>& perm,
+        std::vector<sort_key>& keys, std::vector<sort_key>& tmp, unsigned threads, const std::atomic<bool>* cancel = NULL)
+    {
+        if (perm.size() < 2)
+            return true;
+
+        keys.resize(perm.size());
+        for (std::size_t i=0; i<perm.size(); ++i)
+        {
+            const int row = perm[i];
+            keys[i].row = row;
+            keys[i].key = col.keys[row];
+            if (col.numeric && !ascending)
+                keys[i].key = ~keys[i].key;
+        }
+        bool done = false;
+        if (col.numeric)
+        {
+            done = sort_parallel(keys, tmp, sort_chunk_radix(), sort_key_less(), threads, cancel);
+        }
+        else
+        {
+            const sort_string_less less(col, ascending);
+            done = sort_parallel(keys, tmp, sort_chunk_stable<sort_string_less>(less), less, threads, cancel);
+        }
+        if (!done)
+            return false;
+
+        for (std::size_t i=0; i<perm.size(); ++i)
+            perm[i] = keys[i].row;
+        return true;
+    }
+
+    // Sorted_view is a Database policy adaptor for basic_table. It presents
+    // the rows of the wrapped Database policy in sorted order by sorting a row
+    // index permutation. The source data is never touched.
+    //
+    // Sort keys are computed once per column and cached. By default the
+    // key for a column is the string produced by the converter for that column.
+    // Numeric columns should register an integer key with intkey(), these are
+    // sorted with a radix sort.
+    //
+    // Every sort is stable relative to the current order, so sorting first by
+    // a secondary column and then by a primary column gives a multi column sort.
+    // Sorting the same column again in the opposite direction reuses the current
+    // order and costs O(n).
+    //
+    // Large data sets can be sorted in the background with sort_async().
+    // The rows are sorted on multiple threads while the view keeps showing
+    // the previous order. The application polls with sort_poll() and the new
+    // order is swapped in on the calling thread once the sort is finished.
+    // The source Database is not accessed by the background threads.
+    //
+    // If the source data changes call resort().
+    template<typename Database>
+    class sorted_view : public Database
+    {
+    public:
+        typedef typename Database::value value;
+        typedef std::function<long long (const value&)> int_key;
+        typedef std::function<std::string (const value&)> string_key;
+
+        // Use an integer key for sorting the given column.
+        void intkey(int col, const int_key& key)
+        {
+            sort_cancel();
+            intkeys_[col] = key;
+            cache_.erase(col);
+        }
+
+        // Use a string key for sorting the given column instead of
+        // the converter output.
+        void strkey(int col, const string_key& key)
+        {
+            sort_cancel();
+            strkeys_[col] = key;
+            cache_.erase(col);
+        }
+
+        // Sort the rows by the given column.
+        void sort(int col, bool ascending)
+        {
+            sort_cancel();
+            const sort_column_keys& keys = column_keys(col);
+            if (sort_flip(keys, col, ascending))
+                return;
+            sort_rows(keys, ascending, perm_, keys_, tmp_, sort_threads());
+            sorted(col, ascending);
+        }
+
+        // Start sorting the rows by the given column in the background.
+        // The current order stays in effect until sort_poll() or sort_wait()
+        // picks up the result. Starting another sort cancels the pending one.
+        // The keys are computed (if not cached) before this function returns.
+        void sort_async(int col, bool ascending)
+        {
+            sort_cancel();
+            std::shared_ptr<const sort_column_keys> keys = column_ptr(col);
+            if (sort_flip(*keys, col, ascending))
+                return;
+
+            job_.reset(new sort_job);
+            job_->keys      = keys;
+            job_->perm      = perm_;
+            job_->column    = col;
+            job_->ascending = ascending;
+            job_->cancel    = false;
+            job_->done      = false;
+            job_->thread    = std::thread(&sorted_view::sort_run, job_);
+        }
+
+        // Check whether a background sort is pending.
+        bool sort_pending() const
+        {
+            return job_ != nullptr;
+        }
+
+        // Check whether the background sort is finished and if so
+        // swap in the new order. Returns true if the order changed.
+        bool sort_poll()
+        {
+            if (!job_ || !job_->done)
+                return false;
+            return sort_finish();
+        }
+
+        // Block until the background sort is finished and swap in the new order.
+        // Returns true if the order changed.
+        bool sort_wait()
+        {
+            if (!job_)
+                return false;
+            return sort_finish();
+        }
+
+        // Cancel the background sort if any. The current order stays in effect.
+        // This doesn't wait for the sort threads, they stop on their own
+        // and the result is discarded.
+        void sort_cancel()
+        {
+            if (!job_)
+                return;
+            job_->cancel = true;
+            job_->thread.detach();
+            job_.reset();
+        }
+
+        // Sort by multiple columns. The first column is the primary sort column.
+        void sort(const std::vector<std::pair<int, bool> >& cols)
+        {
+            for (std::vector<std::pair<int, bool> >::const_reverse_iterator it = cols.rbegin(); it != cols.rend(); ++it)
+                sort(it->first, it->second);
+        }
+
+        // Restore the original order.
+        void unsort()
+        {
+            sort_cancel();
+            perm_.clear();
+            history_.clear();
+        }
+
+        // Drop the cached keys and sort again with the same columns.
+        // This needs to be called when the source data changes.
+        void resort()
+        {
+            sort_cancel();
+            std::vector<std::pair<int, bool> > history;
+            history.swap(history_);
+            cache_.clear();
+            perm_.clear();
+            for (std::vector<std::pair<int, bool> >::const_iterator it = history.begin(); it != history.end(); ++it)
+                sort(it->first, it->second);
+        }
+
+        // Map a sorted row to the row in the source Database.
+        int sorted_row(int row) const
+        {
+            if (perm_.empty())
+                return row;
+            assert(row >= 0 && row < static_cast<int>(perm_.size()));
+            return perm_[row];
+        }
+    protected:
+        typedef typename Database::converter converter;
+
+       ~sorted_view()
+        {
+            sort_cancel();
+        }
+        sorted_view() {}
+
+        void fetch(value& val, int index)
+        {
+            Database::fetch(val, sorted_row(index));
+        }
+
+        int size() const
+        {
+            return Database::size();
+        }
+
+        // Get the cached keys for a column. Computes the keys if needed.
+        const sort_column_keys& column_keys(int col)
+        {
+            return *column_ptr(col);
+        }
+
+        // Get the current permutation. Empty when unsorted.
+        std::vector<int>& permutation()
+        {
+            return perm_;
+        }
+    private:
+        // A background sort. The job owns a copy of the permutation and
+        // shares the column keys so that the view can drop its cache while
+        // the job is running. The job is shared with the sort thread so 
+        // that a cancelled sort can finish after the view has let go of it.
+        struct sort_job {
+            std::shared_ptr<const sort_column_keys> keys;
+            std::vector<int> perm;
+            int column;
+            bool ascending;
+            std::atomic<bool> cancel;
+            std::atomic<bool> done;
+            std::thread thread;
+        };
+
+        static void sort_run(std::shared_ptr<sort_job> job)
+        {
+            std::vector<sort_key> keys;
+            std::vector<sort_key> tmp;
+            sort_rows(*job->keys, job->ascending, job->perm, keys, tmp, sort_threads(), &job->cancel);
+            job->done = true;
+        }
+
+        bool sort_finish()
+        {
+            job_->thread.join();
+            perm_.swap(job_->perm);
+            sorted(job_->column, job_->ascending);
+            job_.reset();
+            return true;
+        }
+
+        std::shared_ptr<const sort_column_keys> column_ptr(int col)
+        {
+            typename std::map<int, std::shared_ptr<sort_column_keys> >::iterator it = cache_.find(col);
+            if (it != cache_.end())
+                return it->second;
+
+            std::shared_ptr<sort_column_keys> ptr(new sort_column_keys);
+            sort_column_keys& keys = *ptr;
+            const int max = Database::size();
+            keys.keys.resize(max);
+
+            typename std::map<int, int_key>::const_iterator ik = intkeys_.find(col);
+            typename std::map<int, string_key>::const_iterator sk = strkeys_.find(col);
+            keys.numeric = ik != intkeys_.end();
+            if (!keys.numeric)
+                keys.strings.resize(max);
+
+            for (int i=0; i<max; ++i)
+            {
+                value val;
+                Database::fetch(val, i);
+                if (keys.numeric)
+                {
+                    keys.keys[i] = sort_key_int(ik->second(val));
+                    continue;
+                }
+                std::string& str = keys.strings[i];
+                if (sk != strkeys_.end())
+                {
+                    str = sk->second(val);
+                }
+                else
+                {
+                    converter c(val, col);
+                    str.assign(c.str(), c.len());
+                }
+                keys.keys[i] = sort_key_prefix(str.data(), str.size());
+            }
+            cache_[col] = ptr;
+            return ptr;
+        }
+
+        // Prepare the permutation for sorting. If the column is the last sorted
+        // column there's nothing to sort, the order just needs to be flipped
+        // if the direction changed. Returns true if no sort is needed.
+        bool sort_flip(const sort_column_keys& keys, int col, bool ascending)
+        {
+            if (perm_.empty())
+            {
+                const int max = Database::size();
+                perm_.resize(max);
+                for (int i=0; i<max; ++i)
+                    perm_[i] = i;
+            }
+            if (history_.empty() || history_.back().first != col)
+                return false;
+
+            if (history_.back().second != ascending)
+            {
+                flip(keys);
+                history_.back().second = ascending;
+            }
+            return true;
+        }
+
+        // Record the column as the last sorted column.
+        void sorted(int col, bool ascending)
+        {
+            for (std::vector<std::pair<int, bool> >::iterator it = history_.begin(); it != history_.end(); ++it)
+            {
+                if (it->first == col)
+                {
+                    history_.erase(it);
+                    break;
+                }
+            }
+            history_.push_back(std::make_pair(col, ascending));
+        }
+
+        // Reverse the sort direction. Reversing the permutation also reverses
+        // the order of the rows with equal keys, so reverse those runs back
+        // to keep the sort stable.
+        void flip(const sort_column_keys& col)
+        {
+            std::reverse(perm_.begin(), perm_.end());
+            std::vector<int>::iterator run = perm_.begin();
+            while (run != perm_.end())
+            {
+                std::vector<int>::iterator end = run + 1;
+                while (end != perm_.end() && equal(col, *run, *end))
+                    ++end;
+                std::reverse(run, end);
+                run = end;
+            }
+        }
+
+        bool equal(const sort_column_keys& col, int lhs, int rhs) const
+        {
+            if (col.keys[lhs] != col.keys[rhs])
+                return false;
+            return col.numeric || col.strings[lhs] == col.strings[rhs];
+        }
+
+        std::map<int, int_key> intkeys_;
+        std::map<int, string_key> strkeys_;
+        std::map<int, std::shared_ptr<sort_column_keys> > cache_;
+        std::vector<std::pair<int, bool> > history_;
+        std::vector<int> perm_;
+        std::vector<sort_key> keys_;
+        std::vector<sort_key> tmp_;
+        std::shared_ptr<sort_job> job_;
+    };
+
+} // cli
@@ -0,0 +1,555 @@
+//
+// Copyright (c) 2007 Sami Väisänen
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "config.h"
+
+#include <boost/variant.hpp>
+#include <boost/optional.hpp>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <cassert>
+#include "common.h"
+#include "widget.h"
+
+namespace cli
+{
+    namespace detail {
+
+        // Visitors that call the widget functions with qualified names so
+        // that the calls are bound statically to the concrete widget type.
+        struct static_draw : public boost::static_visitor<rect> {
+            static_draw(buffer& fb) : fb_(fb) {}
+            template<typename T>
+            rect operator()(T* w) const { return w->T::draw(fb_); }
+            buffer& fb_;
+        };
+
+        struct static_animate : public boost::static_visitor<rect> {
+            static_animate(buffer& fb, int elapsed) : fb_(fb), elapsed_(elapsed) {}
+            template<typename T>
+            rect operator()(T* w) const { return w->T::animate(fb_, elapsed_); }
+            buffer& fb_;
+            int elapsed_;
+        };
+
+        struct static_next_frame : public boost::static_visitor<int> {
+            template<typename T>
+            int operator()(const T* w) const { return w->T::next_frame(); }
+        };
+
+        struct static_erase : public boost::static_visitor<rect> {
+            template<typename T>
+            rect operator()(T* w) const { return w->T::erase(); }
+        };
+
+        struct static_bounds : public boost::static_visitor<rect> {
+            template<typename T>
+            rect operator()(const T* w) const
+            {
+                return make_rect(w->T::xpos(), w->T::ypos(), w->T::width(), w->T::height());
+            }
+        };
+
+        struct static_is_valid : public boost::static_visitor<bool> {
+            template<typename T>
+            bool operator()(const T* w) const { return w->T::is_valid(); }
+        };
+
+        struct static_validate : public boost::static_visitor<void> {
+            template<typename T>
+            void operator()(T* w) const { w->T::validate(); }
+        };
+
+        struct static_invalidate : public boost::static_visitor<void> {
+            static_invalidate(bool force) : force_(force) {}
+            template<typename T>
+            void operator()(T* w) const { w->T::invalidate(force_); }
+            bool force_;
+        };
+
+        struct static_keydown : public boost::static_visitor<bool> {
+            static_keydown(int raw, int vk) : raw_(raw), vk_(vk) {}
+            template<typename T>
+            bool operator()(T* w) const { return w->T::keydown(raw_, vk_); }
+            int raw_;
+            int vk_;
+        };
+
+        struct static_paste : public boost::static_visitor<bool> {
+            static_paste(const char* text, size_t len) : text_(text), len_(len) {}
+            template<typename T>
+            bool operator()(T* w) const { return w->T::paste(text_, len_); }
+            const char* text_;
+            size_t len_;
+        };
+
+        struct static_can_focus : public boost::static_visitor<bool> {
+            template<typename T>
+            bool operator()(const T* w) const { return w->T::can_focus(); }
+        };
+
+        struct static_set_focus : public boost::static_visitor<void> {
+            static_set_focus(bool val) : val_(val) {}
+            template<typename T>
+            void operator()(T* w) const { w->T::set_focus(val_); }
+            bool val_;
+        };
+
+        struct static_set_cursor : public boost::static_visitor<void> {
+            static_set_cursor(cursor& c) : c_(c) {}
+            template<typename T>
+            void operator()(T* w) const { w->T::set_cursor(c_); }
+            cursor& c_;
+        };
+
+        struct static_address : public boost::static_visitor<const void*> {
+            template<typename T>
+            const void* operator()(const T* w) const { return w; }
+        };
+
+    } // detail
+
+    // Static_window is a window for a fixed set of widget types. The widget
+    // types are given as template parameters and the widgets are stored in a
+    // variant of pointers to the concrete types. All calls to the widgets are
+    // statically bound, so drawing does not go through the virtual widget interface
+    // and the compiler is free to inline the widget functions. 
+    // The bounding rectangle of each widget is cached and updated whenever
+    // the widget is drawn, updated or moved.
+    //
+    // Static_window works like window except that it doesn't support menus.
+    // Widgets must not change their size or position without being redrawn
+    // or updated through the window.
+    //
+    // static_window<text, checkbox, basic_list<data> > wnd;
+    template<typename... Widgets>
+    class static_window
+    {
+    public:
+        typedef boost::variant<Widgets*...> slot;
+
+        // See window for the events.
+        std::function<void(static_window*)> evtdraw;
+        std::function<void(static_window*, rect)> evterase;
+        std::function<void(static_window*)> evtfocus;
+        std::function<void(static_window*, cursor)> evtcursor;
+
+        static_window() : focused_(NONE), can_close_(false), is_valid_(false), is_open_(false), clock_(0)
+        {
+            cursor_.x = 0;
+            cursor_.y = 0;
+            cursor_.v = false;
+            rc_erase_ = make_rect(0, 0, 0, 0);
+        }
+
+        // Add a widget into this window.
+        template<typename T>
+        void add(T* w)
+        {
+            entry e;
+            e.w     = slot(w);
+            e.rc    = boost::apply_visitor(detail::static_bounds(), e.w);
+            e.stamp = clock_;
+            slots_.push_back(e);
+            if (is_open_)
+            {
+                w->T::invalidate(true);
+                request_draw();
+            }
+        }
+
+        // Remove a widget from this window.
+        template<typename T>
+        void rem(T* w)
+        {
+            const std::size_t i = index(w);
+            if (i == slots_.size())
+                return;
+            if (is_open_)
+            {
+                rc_erase_ = rect_union(rc_erase_, slots_[i].rc);
+                request_draw();
+            }
+            slots_.erase(slots_.begin() + i);
+            if (focused_ == static_cast<int>(i))
+                focused_ = NONE;
+            else if (focused_ > static_cast<int>(i))
+                --focused_;
+        }
+
+        // Try to move the focus to this widget.
+        template<typename T>
+        bool focus(T* w)
+        {
+            const std::size_t i = index(w);
+            assert(i != slots_.size());
+            if (focused_ == static_cast<int>(i) || !w->T::can_focus())
+                return false;
+
+            move_focus(i);
+            if (evtfocus)  evtfocus(this);
+            if (evtdraw)   evtdraw(this);
+            if (evtcursor) evtcursor(this, cursor_);
+            return true;
+        }
+
+        // Request a widget to be redrawn.
+        template<typename T>
+        void update(T* w)
+        {
+            const std::size_t i = index(w);
+            assert(i != slots_.size());
+            w->T::invalidate(true);
+            // the widget may have changed its size.
+            slots_[i].rc = boost::apply_visitor(detail::static_bounds(), slots_[i].w);
+            is_valid_ = false;
+            if (evtdraw)
+                evtdraw(this);
+            if (focused_ == static_cast<int>(i))
+            {
+                cursor_.v = false;
+                w->T::set_cursor(cursor_);
+                if (evtcursor)
+                    evtcursor(this, cursor_);
+            }
+        }
+
+        // Move a widget to a new location. This invalidates the whole window.
+        template<typename T>
+        void move(T* w, int xpos, int ypos)
+        {
+            const std::size_t i = index(w);
+            assert(i != slots_.size());
+            w->T::position(xpos, ypos);
+            slots_[i].rc = boost::apply_visitor(detail::static_bounds(), slots_[i].w);
+            invalidate();
+        }
+
+        // Draw the currently dirty widgets into the frame buffer.
+        // Returns the union of the changed rectangles.
+        rect draw(buffer& fb)
+        {
+            rect erase = {};
+            if (evterase)
+            {
+                for (std::size_t i=0; i<slots_.size(); ++i)
+                {
+                    const rect r = boost::apply_visitor(detail::static_erase(), slots_[i].w);
+                    if (!rect_is_empty(r))
+                        erase = rect_union(erase, r);
+                }
+                erase = rect_union(rc_erase_, erase);
+                evterase(this, erase);
+            }
+
+            const detail::static_draw draw(fb);
+            rect rc = {};
+            for (std::size_t i=0; i<slots_.size(); ++i)
+            {
+                entry& e = slots_[i];
+                if (!rect_is_empty(erase) && rect_intersects_rect(e.rc, erase))
+                    boost::apply_visitor(detail::static_invalidate(true), e.w);
+
+                if (static_cast<int>(i) == focused_ || boost::apply_visitor(detail::static_is_valid(), e.w))
+                    continue;
+
+                rc = rect_union(rc, draw_slot(e, draw));
+            }
+            // draw the focused widget last. 
+            if (focused_ != NONE)
+            {
+                entry& e = slots_[focused_];
+                if (boost::apply_visitor(detail::static_is_valid(), e.w) && rect_intersects_rect(e.rc, rc))
+                    boost::apply_visitor(detail::static_invalidate(true), e.w);
+
+                cursor_.v = false;
+                if (!boost::apply_visitor(detail::static_is_valid(), e.w))
+                    rc = rect_union(rc, draw_slot(e, draw));
+                boost::apply_visitor(detail::static_set_cursor(cursor_), e.w);
+            }
+            is_valid_ = true;
+            rc_erase_ = make_rect(0, 0, 0, 0);
+            return rect_union(rc, erase);
+        }
+
+        // Animate the widgets whose next frame is due.
+        // Returns the union of the changed rectangles.
+        rect animate(buffer& fb, int elapsed)
+        {
+            clock_ += elapsed;
+
+            rect ret = {};
+            for (std::size_t i=0; i<slots_.size(); ++i)
+            {
+                if (static_cast<int>(i) == focused_)
+                    continue;
+                ret = rect_union(ret, animate_slot(slots_[i], fb));
+            }
+            if (focused_ != NONE)
+            {
+                entry& e = slots_[focused_];
+                const rect r = animate_slot(e, fb);
+                if (!rect_is_empty(r))
+                    ret = rect_union(ret, r);
+                else if (rect_intersects_rect(e.rc, ret))
+                {
+                    // some other widget animated over the focused widget
+                    boost::apply_visitor(detail::static_invalidate(true), e.w);
+                    ret = rect_union(ret, draw_slot(e, detail::static_draw(fb)));
+                }
+            }
+            return ret;
+        }
+
+        // Get the number of milliseconds until the next animation is due.
+        // Returns -1 if no widget has anything to animate.
+        int next_frame() const
+        {
+            int next = -1;
+            for (std::size_t i=0; i<slots_.size(); ++i)
+            {
+                const int frame = boost::apply_visitor(detail::static_next_frame(), slots_[i].w);
+                if (frame < 0)
+                    continue;
+                const long long left = std::max<long long>(0, slots_[i].stamp + frame - clock_);
+                if (next == -1 || left < next)
+                    next = static_cast<int>(left);
+            }
+            return next;
+        }
+
+        // Invalidate all widgets. Will force complete redraw.
+        void invalidate()
+        {
+            for (std::size_t i=0; i<slots_.size(); ++i)
+                boost::apply_visitor(detail::static_invalidate(true), slots_[i].w);
+            request_draw();
+        }
+
+        // Process a keypress. See window::keydown.
+        bool keydown(int raw, int vk)
+        {
+            if (vk == VK_KILL_WINDOW && can_close_)
+            {
+                is_open_ = false;
+                return true;
+            }
+            else if (vk == VK_FOCUS_NEXT || vk == VK_FOCUS_PREV)
+            {
+                const std::size_t count = slots_.size();
+                std::size_t pos = focused_ == NONE ? 0 : focused_;
+                for (std::size_t i=0; i<count; ++i)
+                {
+                    if (vk == VK_FOCUS_NEXT)
+                        pos = (pos + 1) % count;
+                    else
+                        pos = pos == 0 ? count - 1 : pos - 1;
+                    if (!boost::apply_visitor(detail::static_can_focus(), slots_[pos].w))
+                        continue;
+                    move_focus(pos);
+                    break;
+                }
+                if (evtfocus)
+                    evtfocus(this);
+            }
+            else
+            {
+                if (focused_ == NONE)
+                    return false;
+                if (!boost::apply_visitor(detail::static_keydown(raw, vk), slots_[focused_].w))
+                    return false;
+            }
+            input_done();
+            return true;
+        }
+
+        // Process pasted text. See window::paste.
+        bool paste(const char* text, size_t len)
+        {
+            if (focused_ == NONE)
+                return false;
+            if (!boost::apply_visitor(detail::static_paste(text, len), slots_[focused_].w))
+                return false;
+            input_done();
+            return true;
+        }
+
+        // Prepare the window for display and focus the first focusable widget.
+        void show()
+        {
+            cursor_.v = false;
+            is_open_  = true;
+            if (focused_ != NONE)
+            {
+                boost::apply_visitor(detail::static_set_focus(true), slots_[focused_].w);
+                boost::apply_visitor(detail::static_set_cursor(cursor_), slots_[focused_].w);
+                return;
+            }
+            for (std::size_t i=0; i<slots_.size(); ++i)
+            {
+                if (boost::apply_visitor(detail::static_can_focus(), slots_[i].w))
+                {
+                    boost::apply_visitor(detail::static_set_focus(true), slots_[i].w);
+                    boost::apply_visitor(detail::static_set_cursor(cursor_), slots_[i].w);
+                    focused_ = static_cast<int>(i);
+                    break;
+                }
+            }
+        }
+
+        void close()
+        {
+            is_open_ = false;
+        }
+
+        const cursor& curs() const
+        {
+            return cursor_;
+        }
+
+        // Get the currently focused widget. Empty if no widget has focus.
+        boost::optional<slot> focused() const
+        {
+            if (focused_ == NONE)
+                return boost::optional<slot>();
+            return slots_[focused_].w;
+        }
+
+        bool is_valid() const
+        {
+            return is_valid_;
+        }
+        bool is_open() const
+        {
+            return is_open_;
+        }
+        template<typename T>
+        bool has_widget(const T* w) const
+        {
+            return index(w) != slots_.size();
+        }
+
+        // Disable/enable VK_KILL_WINDOW.
+        void can_close_on_vk(bool val)
+        {
+            can_close_ = val;
+        }
+    private:
+        enum { NONE = -1 };
+
+        struct entry {
+            slot w;
+            rect rc;
+            long long stamp;
+        };
+
+        template<typename T>
+        std::size_t index(const T* w) const
+        {
+            for (std::size_t i=0; i<slots_.size(); ++i)
+            {
+                if (boost::apply_visitor(detail::static_address(), slots_[i].w) == w)
+                    return i;
+            }
+            return slots_.size();
+        }
+
+        rect draw_slot(entry& e, const detail::static_draw& draw)
+        {
+            const rect r = boost::apply_visitor(draw, e.w);
+            boost::apply_visitor(detail::static_validate(), e.w);
+            e.rc    = boost::apply_visitor(detail::static_bounds(), e.w);
+            e.stamp = clock_;
+            return r;
+        }
+
+        rect animate_slot(entry& e, buffer& fb)
+        {
+            rect r = {};
+            const int frame = boost::apply_visitor(detail::static_next_frame(), e.w);
+            if (frame < 0)
+                e.stamp = clock_;
+            else if (clock_ - e.stamp >= frame)
+            {
+                r = boost::apply_visitor(detail::static_animate(fb, static_cast<int>(clock_ - e.stamp)), e.w);
+                e.stamp = clock_;
+            }
+            return r;
+        }
+
+        void move_focus(std::size_t i)
+        {
+            cursor_.v = false;
+            if (focused_ != NONE)
+            {
+                boost::apply_visitor(detail::static_set_focus(false), slots_[focused_].w);
+                boost::apply_visitor(detail::static_invalidate(true), slots_[focused_].w);
+            }
+            focused_ = static_cast<int>(i);
+            boost::apply_visitor(detail::static_set_focus(true), slots_[i].w);
+            boost::apply_visitor(detail::static_set_cursor(cursor_), slots_[i].w);
+            boost::apply_visitor(detail::static_invalidate(true), slots_[i].w);
+            is_valid_ = false;
+        }
+
+        void input_done()
+        {
+            for (std::size_t i=0; i<slots_.size(); ++i)
+            {
+                if (!boost::apply_visitor(detail::static_is_valid(), slots_[i].w))
+                {
+                    is_valid_ = false;
+                    break;
+                }
+            }
+            if (!is_valid_)
+            {
+                if (evtdraw)   evtdraw(this);
+                if (evtcursor) evtcursor(this, cursor_);
+            }
+        }
+
+        void request_draw()
+        {
+            is_valid_ = false;
+            if (evtdraw)
+                evtdraw(this);
+        }
+
+        std::vector<entry> slots_;
+        int  focused_;
+        bool can_close_;
+        bool is_valid_;
+        bool is_open_;
+        cursor cursor_;
+        rect rc_erase_;
+        long long clock_;
+    };
+
+} // cli
@@ -30,15 +30,15 @@
 #include "widget.h"
 #include "common.h"
 #include "ticker.h"
+#include "formatter.h"
 #include "pager.h"
 #include "singlesel.h"
+#include "finder.h"
 #include "buffer.h"
 
 #include <vector>
 #include <algorithm>
-#include <sstream>
 #include <string>
-#include <iomanip>
 #include <cassert>
 
 namespace cli
@@ -51,9 +51,10 @@ namespace cli
     template<typename Database,
              typename Selector = default_single_selection,
              typename Ticker   = default_ticker,
-             typename Pager    = default_pager>
+             typename Pager    = default_pager,
+             typename Finder   = default_finder>
     class basic_table : public widget, 
-      public Database, public Selector, public Ticker, public Pager
+      public Database, public Selector, public Ticker, public Pager, public Finder
     {
     public:
         basic_table() : focus_(false), color_(COLOR_INACTIVE), width_(0), height_(0), cellspacing_(0) {}
@@ -77,9 +78,9 @@ namespace cli
             typedef typename Database::converter converter;
             typedef typename vector_type::const_iterator iter;
 
-            cell def = {' ', ATTRIB_NONE, COLOR_NONE};
-            cell sel = {' ', ATTRIB_NONE, COLOR_SELECTION};
-            cell col = {' ', ATTRIB_NONE, color_};
+            cell def = {' ', ATTRIB_NONE, COLOR_NONE, 0, 0};
+            cell sel = {' ', ATTRIB_NONE, COLOR_SELECTION, 0, 0};
+            cell col = {' ', ATTRIB_NONE, color_, 0, 0};
             formatter f(def, fb);
             f.fillblank(true);
 
@@ -142,6 +143,13 @@ namespace cli
             }
             return ret;
         }
+        int next_frame() const
+        {
+            if (!focus_ || Database::size() == 0)
+                return -1;
+            return Ticker::next_frame();
+        }
+
         rect animate(buffer& fb, int elapsed)
         {
             rect ret = {};
@@ -155,7 +163,10 @@ namespace cli
             int pos = Pager::pagepos(row, height_);
             if (!Ticker::is_set())
             {
-                std::stringstream ss;
+                // the line buffer is kept around so that composing
+                // the ticker line doesn't allocate once it has grown.
+                std::string& line = tickerline_;
+                line.clear();
                 value val;
                 Database::fetch(val, row);
                 for (int x=0; x<(int)columns_.size(); ++x)
@@ -163,13 +174,13 @@ namespace cli
                     const column& col = columns_[x];
                     if (col.width == 0) continue; // skip 0 length columns
                     converter conv(val, x);
-                    const char*   str = conv.str();
-                    size_t        len = conv.len();
-                    std::string   tmp(str, len);
-                    ss << std::left << std::setw(col.width) << tmp;
-                    ss << std::setw(cellspacing_) << "";
+                    const size_t len = conv.len();
+                    line.append(conv.str(), len);
+                    if (len < static_cast<size_t>(col.width))
+                        line.append(col.width - len, ' ');
+                    line.append(cellspacing_, ' ');
                 }
-                Ticker::set(ss.str(), width_);
+                Ticker::set(line, width_);
             }
             Ticker::scroll(fb, xpos_, ypos_ + pos);
             ret.top    = ypos_ + pos;
@@ -185,18 +196,19 @@ namespace cli
             return Pager::getvisible(Selector::selpos(), height_, Database::size());
         }
         
-        bool keydown(int key, int vk)
+        bool keydown(int raw, int vk)
         {
             bool invalid = true;
             if (Selector::keydown(vk, height_, Database::size(), invalid))
             {
                 if (invalid)
                     Pager::invalidate();
+                Finder::reset();
                 Ticker::reset();
                 valid_ = false;
                 return true;
             }
-            return false;
+            return find(raw, vk);
         }
         
         void invalidate(bool force)
@@ -269,6 +281,39 @@ namespace cli
         }
 
     private:
+        // Function object for the Finder to get the text of a row.
+        struct search_loader {
+            search_loader(basic_table* w) : widget_(w) {}
+            void operator()(int row, int col, std::string& str) const
+            {
+                typedef typename Database::value     value;
+                typedef typename Database::converter converter;
+                value val;
+                widget_->Database::fetch(val, row);
+                converter c(val, col);
+                str.assign(c.str(), c.len());
+            }
+            basic_table* widget_;
+        };
+
+        // Try to move the selection with the type-ahead search.
+        bool find(int raw, int vk)
+        {
+            int row = Selector::selpos();
+            if (!Finder::keydown(raw, vk, Database::size(), row, search_loader(this)))
+                return false;
+            if (row != Selector::selpos())
+            {
+                Selector::selpos(row);
+                if (Selector::evtrow)
+                    Selector::evtrow();
+            }
+            Pager::invalidate();
+            Ticker::reset();
+            valid_ = false;
+            return true;
+        }
+
         struct column {
             std::size_t width;
         };
@@ -280,6 +325,7 @@ namespace cli
         int height_;
         int cellspacing_;
         std::vector<column> columns_;
+        std::string tickerline_;
        
     };
 
@@ -27,8 +27,11 @@
 
 #include "config.h"
 
+#include "gapbuffer.h"
 #include <string>
 #include <vector>
+#include <algorithm>
+#include <cstring>
 #include <cassert>
 
 namespace cli
@@ -75,11 +78,184 @@ namespace cli
             return tabs_[pos_ % tabs_.size()];
         }
 
-        void update(const std::string&, char) {}
+        template<typename Text>
+        void update(const Text&, char) {}
     private:
         list         tabs_;
         mutable int  pos_;
     };
 
+    // Prefix_tablist completes the typed input from a list of candidates,
+    // such as host or metric names. Tab completion cycles through the 
+    // candidates that start with the current input.
+    //
+    // The candidates are kept in a single character array indexed by a 
+    // sorted offset array, so the candidates starting with a prefix are a 
+    // contiguous range. Typing another character narrows the range with a
+    // binary search on that character only. Cycling through the range
+    // doesn't allocate once the completion string has grown to fit.
+    class prefix_tablist
+    {
+    public:
+        typedef std::vector<std::string> list;
+
+        // Set the candidates. Duplicates are removed.
+        void setlist(const list& tabs)
+        {
+            chars_.clear();
+            index_.clear();
+            index_.reserve(tabs.size());
+            for (list::size_type i=0; i<tabs.size(); ++i)
+            {
+                entry e;
+                e.offset = static_cast<unsigned>(chars_.size());
+                e.len    = static_cast<unsigned>(tabs[i].size());
+                chars_.insert(chars_.end(), tabs[i].begin(), tabs[i].end());
+                index_.push_back(e);
+            }
+            if (chars_.empty())
+                chars_.push_back(0);
+
+            std::sort(index_.begin(), index_.end(), entry_less(&chars_[0]));
+            index_.erase(std::unique(index_.begin(), index_.end(), entry_equal(&chars_[0])), index_.end());
+            prefix_.clear();
+            first_ = 0;
+            last_  = static_cast<int>(index_.size());
+            pos_   = -1;
+        }
+
+        // Get the number of candidates.
+        int size() const
+        {
+            return static_cast<int>(index_.size());
+        }
+
+        // Get the number of candidates matching the current input.
+        int matches() const
+        {
+            return last_ - first_;
+        }
+    protected:
+        prefix_tablist() : first_(0), last_(0), pos_(-1) {}
+       ~prefix_tablist() {}
+
+        const std::string& next()
+        {
+            if (first_ == last_)
+                return empty();
+            pos_ = (pos_ == -1 || pos_ + 1 == last_) ? first_ : pos_ + 1;
+            return current();
+        }
+        const std::string& prev()
+        {
+            if (first_ == last_)
+                return empty();
+            pos_ = (pos_ == -1 || pos_ == first_) ? last_ - 1 : pos_ - 1;
+            return current();
+        }
+
+        void update(const std::string& input, char)
+        {
+            update_text(input);
+        }
+        void update(const gap_buffer& input, char)
+        {
+            update_text(input);
+        }
+    private:
+        template<typename Text>
+        void update_text(const Text& input)
+        {
+            size_t k = prefix_.size();
+            if (!text_starts_with(input, prefix_))
+            {
+                // not an extension of the previous input. start over.
+                first_ = 0;
+                last_  = static_cast<int>(index_.size());
+                k = 0;
+            }
+            for (; k<input.size() && first_ != last_; ++k)
+                narrow(k, static_cast<unsigned char>(input[k]));
+            text_assign(prefix_, input);
+            pos_    = -1;
+        }
+
+        struct entry {
+            unsigned offset;
+            unsigned len;
+        };
+
+        struct entry_less {
+            entry_less(const char* chars) : chars_(chars) {}
+            bool operator()(const entry& lhs, const entry& rhs) const
+            {
+                const int ret = std::memcmp(chars_ + lhs.offset, chars_ + rhs.offset, std::min(lhs.len, rhs.len));
+                if (ret)
+                    return ret < 0;
+                return lhs.len < rhs.len;
+            }
+            const char* chars_;
+        };
+
+        struct entry_equal {
+            entry_equal(const char* chars) : chars_(chars) {}
+            bool operator()(const entry& lhs, const entry& rhs) const
+            {
+                return lhs.len == rhs.len && std::memcmp(chars_ + lhs.offset, chars_ + rhs.offset, lhs.len) == 0;
+            }
+            const char* chars_;
+        };
+
+        // compare the character at position k of entries that all 
+        // share the same first k characters. entries that end before
+        // k sort first.
+        struct char_less {
+            char_less(const char* chars, size_t k) : chars_(chars), k_(k) {}
+            int key(const entry& e) const
+            {
+                return e.len > k_ ? static_cast<unsigned char>(chars_[e.offset + k_]) : -1;
+            }
+            bool operator()(const entry& e, int ch) const
+            {
+                return key(e) < ch;
+            }
+            bool operator()(int ch, const entry& e) const
+            {
+                return ch < key(e);
+            }
+            const char* chars_;
+            size_t k_;
+        };
+
+        void narrow(size_t k, int ch)
+        {
+            typedef std::vector<entry>::const_iterator iter;
+            const std::pair<iter, iter> range = std::equal_range(index_.begin() + first_, 
+                index_.begin() + last_, ch, char_less(&chars_[0], k));
+            first_ = static_cast<int>(range.first - index_.begin());
+            last_  = static_cast<int>(range.second - index_.begin());
+        }
+
+        const std::string& current()
+        {
+            const entry& e = index_[pos_];
+            current_.assign(&chars_[e.offset], e.len);
+            return current_;
+        }
+        const std::string& empty()
+        {
+            current_.clear();
+            return current_;
+        }
+
+        std::vector<char>  chars_;
+        std::vector<entry> index_;
+        std::string prefix_;
+        std::string current_;
+        int first_;
+        int last_;
+        int pos_;
+    };
+
 } // cli
 
@@ -32,13 +32,17 @@
 #  include <vector>
 #  pragma comment(lib, "user32.lib")
 #else
+#  define NCURSES_WIDECHAR 1
 #  include <curses.h>
+#  include <clocale>
 #endif
 
 #include <cassert>
 
 #include "window.h"
 #include "buffer.h"
+#include "unicode.h"
+#include "color.h"
 
 namespace cli
 {
@@ -58,6 +62,19 @@ WORD map_color(short col)
     }
 }
 
+// map an extended color to the console color bits
+// in the foreground position (blue, green, red, intensity).
+WORD map_ext_color(unsigned color)
+{
+    const int ansi = xterm256_to_ansi16(color_to_xterm256(color));
+    WORD ret = 0;
+    if (ansi & 1) ret |= FOREGROUND_RED;
+    if (ansi & 2) ret |= FOREGROUND_GREEN;
+    if (ansi & 4) ret |= FOREGROUND_BLUE;
+    if (ansi & 8) ret |= FOREGROUND_INTENSITY;
+    return ret;
+}
+
 WORD map_attrib(short attr)
 {
     if (attr & ATTRIB_BOLD)
@@ -141,12 +158,24 @@ int term_get_key()
    return ch;
 }
 
+int term_wait_key(int millis)
+{
+    const DWORD start = GetTickCount();
+    while (!_kbhit())
+    {
+        if (GetTickCount() - start >= static_cast<DWORD>(millis))
+            return -1;
+        Sleep(10);
+    }
+    return term_get_key();
+}
+
 void term_show_cursor(const cursor& curs)
 {
     // todo:
 }
 
-void term_draw_buffer(const buffer& buff, const rect& src)
+int term_draw_buffer(const buffer& buff, const rect& src)
 {
     typedef buffer::row_type row;    
 
@@ -168,15 +197,28 @@ void term_draw_buffer(const buffer& buff, const rect& src)
             if (c.value == 0)
                 continue;
             CHAR_INFO& cc = buffer[i * col_count + x];
-            cc.Char.AsciiChar = c.value;
-            cc.Attributes     = 0;
-            if (c.color == COLOR_NONE)
+            if (c.value == CELL_WIDE_TAIL)
+            {
+                // the console wants the character repeated in both halves.
+                const CHAR_INFO& lead = buffer[i * col_count + x - 1];
+                cc.Char.UnicodeChar = lead.Char.UnicodeChar;
+                cc.Attributes       = (lead.Attributes & ~COMMON_LVB_LEADING_BYTE) | COMMON_LVB_TRAILING_BYTE;
+                continue;
+            }
+            // the console only does the basic multilingual plane.
+            cc.Char.UnicodeChar = static_cast<WCHAR>(c.value < 0x10000 ? c.value : UNICODE_REPLACEMENT);
+            cc.Attributes       = 0;
+            if (c.fg || c.bg)
+                cc.Attributes = (c.fg ? map_ext_color(c.fg) : attrib) | (c.bg ? map_ext_color(c.bg) << 4 : 0);
+            else if (c.color == COLOR_NONE)
                 cc.Attributes = attrib;
             else
                 cc.Attributes |= map_color(c.color);
 
             if (c.attrib != ATTRIB_NONE) 
                 cc.Attributes |= map_attrib(c.attrib);
+            if (x + 1 < col_count && r[x + 1].value == CELL_WIDE_TAIL)
+                cc.Attributes |= COMMON_LVB_LEADING_BYTE;
         }
     }
     HANDLE out = GetStdHandle(STD_OUTPUT_HANDLE);
@@ -184,15 +226,29 @@ void term_draw_buffer(const buffer& buff, const rect& src)
     COORD buffercoord = { rc.left, rc.top };
     SMALL_RECT rect   = { rc.left, rc.top, rc.right-1, rc.bottom-1};
 
-    BOOL ret = WriteConsoleOutput(out, &buffer[0], buffersize, buffercoord, &rect);
+    BOOL ret = WriteConsoleOutputW(out, &buffer[0], buffersize, buffercoord, &rect);
     assert( ret == TRUE );
     ret = 0;    
+    return (src.right - src.left) * (src.bottom - src.top) * sizeof(CHAR_INFO);
+}
+
+void term_enable_paste(bool)
+{
+    // the console has no bracketed paste.
+}
+
+const std::string& term_paste_text()
+{
+    static const std::string none;
+    return none;
 }
 
 #else
 
 void term_init()
 {
+    // use the UTF-8 locale of the environment.
+    setlocale(LC_ALL, "");
     initscr();
     start_color();
     keypad(stdscr, TRUE);
@@ -202,8 +258,62 @@ void term_init()
     curs_set(0);
 }
 
+namespace {
+    // -1 can be used for the terminal default color.
+    bool default_colors;
+
+    color_pair_cache& dynamic_pairs()
+    {
+        // small terminals don't have room for the application pairs.
+        static const int first = COLOR_PAIRS > 2 * TERM_FIRST_DYNAMIC_PAIR ? int(TERM_FIRST_DYNAMIC_PAIR) : int(COLOR_SENTINEL);
+        static color_pair_cache cache(first, std::max(1, std::min(COLOR_PAIRS, 0x7fff) - first));
+        return cache;
+    }
+
+    // map an extended color to the nearest color the terminal has.
+    short map_ext_color(unsigned color, short def)
+    {
+        const int index = color_to_xterm256(color);
+        if (index == -1)
+            return default_colors ? -1 : def;
+        if (COLORS >= 256)
+            return index;
+        const int ansi = xterm256_to_ansi16(index);
+        return COLORS >= 16 ? ansi : ansi & 7;
+    }
+
+    // get the color pair for the cell.
+    short map_color_pair(const cell& c)
+    {
+        if (!c.fg && !c.bg)
+            return c.color;
+
+        // consecutive cells usually have the same colors.
+        static unsigned last_fg, last_bg;
+        static short last_pair;
+        if (c.fg == last_fg && c.bg == last_bg && last_pair)
+            return last_pair;
+
+        const short fg = map_ext_color(c.fg, COLOR_WHITE);
+        const short bg = map_ext_color(c.bg, COLOR_BLACK);
+        int pair = 0;
+        if (dynamic_pairs().lookup(fg, bg, pair))
+            init_pair(pair, fg, bg);
+        last_fg   = c.fg;
+        last_bg   = c.bg;
+        last_pair = pair;
+        return pair;
+    }
+
+    // the color pair each cell on the screen was drawn with. the dynamic
+    // pairs count their cells so that a pair on the screen isn't reassigned.
+    std::vector<short> screen_pairs;
+} // namespace
+
 void term_init_colors()
 {
+    default_colors = use_default_colors() == OK;
+
     // id, foreground, background
     init_pair(COLOR_SELECTION, COLOR_BLACK, COLOR_GREEN);
     init_pair(COLOR_MENUITEM,  COLOR_BLACK, COLOR_WHITE);
@@ -213,6 +323,7 @@ void term_init_colors()
 
 void term_uninit()
 {
+    term_enable_paste(false);
     endwin();
 }
 
@@ -223,9 +334,88 @@ size term_get_size()
     return ret;
 }
 
+namespace {
+    std::string paste_text;
+    bool paste_enabled;
+
+    // the pasted text arrives in a burst. a gap this long
+    // means the closing bracket was lost.
+    const int PASTE_TIMEOUT = 500;
+
+    // Check whether the escape that was just read starts a bracketed
+    // paste and if so read the pasted text up to the closing bracket.
+    bool read_paste()
+    {
+        if (!paste_enabled)
+            return false;
+
+        static const char begin[] = "[200~";
+        static const char end[]   = "\033[201~";
+
+        // the rest of the sequence is already waiting if it's there.
+        int seq[5];
+        int len = 0;
+        nodelay(stdscr, TRUE);
+        for (; len<5; ++len)
+        {
+            seq[len] = getch();
+            if (seq[len] != begin[len])
+                break;
+        }
+        nodelay(stdscr, FALSE);
+        if (len != 5)
+        {
+            // not a paste. put back what was read.
+            if (seq[len] != ERR)
+                ungetch(seq[len]);
+            while (len)
+                ungetch(seq[--len]);
+            return false;
+        }
+        // the text past the limit is read and dropped so 
+        // that it doesn't come through as keys.
+        paste_text.clear();
+        size_t matched = 0;
+        timeout(PASTE_TIMEOUT);
+        while (true)
+        {
+            const int ch = getch();
+            if (ch == ERR)
+                break;
+            if (paste_text.size() < TERM_PASTE_LIMIT + 6)
+                paste_text.push_back(static_cast<char>(ch));
+            matched = ch == end[matched] ? matched + 1 : (ch == end[0] ? 1 : 0);
+            if (matched == 6)
+            {
+                paste_text.resize(paste_text.size() - 6);
+                break;
+            }
+        }
+        timeout(-1);
+        if (paste_text.size() > TERM_PASTE_LIMIT)
+            paste_text.resize(TERM_PASTE_LIMIT);
+        return true;
+    }
+} // namespace
+
+void term_enable_paste(bool on)
+{
+    // ask the terminal to bracket pasted text with ESC[200~ and ESC[201~
+    if (on != paste_enabled)
+        putp(on ? "\033[?2004h" : "\033[?2004l");
+    paste_enabled = on;
+}
+
+const std::string& term_paste_text()
+{
+    return paste_text;
+}
+
 int term_get_key()
 {
     int ch = getch();
+    if (ch == 27 && read_paste())
+        return TERM_PASTE;
     switch (ch)
     {
         case KEY_DOWN:  return TERM_MOVE_DOWN;  
@@ -240,6 +430,16 @@ int term_get_key()
     return ch; 
 }
 
+int term_wait_key(int millis)
+{
+    timeout(millis);
+    int ch = term_get_key();
+    timeout(-1);
+    if (ch == ERR)
+        return -1;
+    return ch;
+}
+
 void term_show_cursor(const cursor& curs)
 {
     move(curs.y, curs.x);
@@ -250,7 +450,7 @@ void term_show_cursor(const cursor& curs)
     refresh();        
 }
 
-void term_draw_buffer(const buffer& buff, const rect& src)
+int term_draw_buffer(const buffer& buff, const rect& src)
 {
     typedef buffer::row_type row;
 
@@ -258,6 +458,13 @@ void term_draw_buffer(const buffer& buff, const rect& src)
     // using ncurses as the "rendering" back end.
     int lower_bound = src.top;
     int upper_bound = src.bottom;
+    int bytes = 0;
+    if (screen_pairs.size() != buff.rows() * buff.cols())
+    {
+        // the screen was resized and is redrawn.
+        dynamic_pairs().release_all();
+        screen_pairs.assign(buff.rows() * buff.cols(), COLOR_NONE);
+    }
     for (; lower_bound < upper_bound; ++lower_bound)
     {
         const row& r = buff[lower_bound];
@@ -265,10 +472,17 @@ void term_draw_buffer(const buffer& buff, const rect& src)
         for (size_t i=0; i<r.size(); ++i)
         {
             const cell& c = r[i];
-            if (c.value == 0)
+            if (c.value == 0 || c.value == CELL_WIDE_TAIL)
                 continue;
             
-            if (c.color != COLOR_NONE)  attron(COLOR_PAIR(c.color));
+            // the old pair of the cell is released first so 
+            // that it can be reassigned for the new colors.
+            short& shown = screen_pairs[lower_bound * buff.cols() + i];
+            dynamic_pairs().release(shown);
+            const short pair = map_color_pair(c);
+            dynamic_pairs().retain(pair);
+            shown = pair;
+            if (pair != COLOR_NONE) color_set(pair, nullptr);
             if (c.attrib != ATTRIB_NONE)
             {
                 if (c.attrib & ATTRIB_UNDERLINE) attron(A_UNDERLINE);
@@ -279,8 +493,21 @@ void term_draw_buffer(const buffer& buff, const rect& src)
             int y = lower_bound;
             int x = i;
             move(y, x);
-            printw("%c", c.value);
-            if (c.color != COLOR_NONE) attroff(COLOR_PAIR(c.color));
+            if (c.value < 0x80)
+            {
+                addch(c.value);
+                ++bytes;
+            }
+            else
+            {
+                const wchar_t wc[2] = {static_cast<wchar_t>(c.value), 0};
+                cchar_t cc;
+                setcchar(&cc, wc, A_NORMAL, 0, nullptr);
+                add_wch(&cc);
+                char utf8[4];
+                bytes += utf8_encode(c.value, utf8);
+            }
+            if (pair != COLOR_NONE) color_set(COLOR_NONE, nullptr);
             if (c.attrib != ATTRIB_NONE)
             {
                 if (c.attrib & ATTRIB_UNDERLINE) attroff(A_UNDERLINE);
@@ -291,6 +518,7 @@ void term_draw_buffer(const buffer& buff, const rect& src)
         }
     }
     refresh();
+    return bytes;
 }
 
 #endif
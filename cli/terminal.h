@@ -26,6 +26,7 @@
 #pragma once
 
 #include "common.h"
+#include <string>
 
 namespace cli
 {
@@ -51,9 +52,15 @@ enum term_funtion_keys
     TERM_MOVE_DOWN_PAGE,
     TERM_MOVE_UP_PAGE,
     TERM_MOVE_NEXT,
-    TERM_MOVE_PREV
+    TERM_MOVE_PREV,
+    TERM_PASTE      // A block of text was pasted, see term_paste_text.
 };
 
+// Cells with extended colors (see color.h) are drawn using color pairs
+// allocated on demand starting from this pair. The pairs between 
+// COLOR_SENTINEL and this are free for the application to use.
+enum { TERM_FIRST_DYNAMIC_PAIR = 64 };
+
 // Initialize the terminal for use. 
 void term_init();
 
@@ -67,13 +74,34 @@ void term_uninit();
 size term_get_size();
 
 // Transfer the contents of the given frame buffer to
-// the "physical" terminal window.
-void term_draw_buffer(const buffer& buff, const rect& src);
+// the "physical" terminal window. Returns the number of bytes
+// handed to the native terminal API.
+int  term_draw_buffer(const buffer& buff, const rect& src);
 
 // Read next input key from the input queue. Will block untill
 // a key is available.
 int  term_get_key();
 
+// Read next input key from the input queue. Waits at most 
+// the given number of milliseconds for a key to become available
+// and returns -1 if no key was available in time.
+int  term_wait_key(int millis);
+
+// Enable or disable bracketed paste. When enabled terminals that support
+// it deliver pasted text in one go as a TERM_PASTE instead of a key at a 
+// time. It is off by default since an application that doesn't handle 
+// TERM_PASTE would lose the pasted text. Call after term_init. Currently 
+// only the ncurses layer supports this.
+void term_enable_paste(bool on);
+
+// Get the text of the last TERM_PASTE, which can be passed on to 
+// window::paste. The text stays valid until the next TERM_PASTE.
+// A paste whose closing bracket doesn't arrive in time is cut short
+// and pastes longer than TERM_PASTE_LIMIT bytes are truncated.
+const std::string& term_paste_text();
+
+enum { TERM_PASTE_LIMIT = 1 << 20 };
+
 // Show or hide cursor depending the cursor state.
 void term_show_cursor(const cursor& curs);
 
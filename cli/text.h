@@ -44,7 +44,7 @@ namespace cli
 
         rect draw(buffer& fb)
         {
-            cell c = {' ', attrib_, color_};
+            cell c = {' ', attrib_, color_, 0, 0};
             formatter f(c, fb);
             
             f.move(xpos_, ypos_);
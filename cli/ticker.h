@@ -28,17 +28,20 @@
 #include "config.h"
 
 #include "common.h"
-#include "formatter.h"
 #include "buffer.h"
+#include "unicode.h"
 
 #include <string>
-#include <sstream>
-#include <iomanip>
+#include <vector>
+#include <algorithm>
 #include <cassert>
 
 namespace cli
 {
     // Implements vertical text scrolling from right to left.
+    // The line is rendered once into an array of cells that holds
+    // the padded line twice in a row, so that every frame of the scroll
+    // is a contiguous slice of the array and scrolling is a single copy.
     class right_to_left_ticker
     {
     public:
@@ -50,51 +53,71 @@ namespace cli
         {
             idle_treshold_ = millis;
         }
+        // Set the time between two scroll steps.
+        void set_frame_interval(int millis)
+        {
+            frame_interval_ = millis;
+        }
     protected:
        ~right_to_left_ticker() {}
-        right_to_left_ticker() : enabled_(true),idle_treshold_(2000),
-                   pivot_(0), wait_(0), width_(0) {}
+        right_to_left_ticker() : enabled_(true),idle_treshold_(2000), frame_interval_(150),
+                   pivot_(0), wait_(0), width_(0), length_(0) {}
 
         void scroll(buffer& fb, int xpos, int ypos)
         {
             if (!enabled_) return;
 
-            assert(!line_.empty());
-            const char* ptr = line_.c_str();
-            int charc = 0;
-            pivot_ = pivot_ % line_.length();
-            charc  = std::min<int>(line_.length() - pivot_, width_);
-            
-            cell def = {0, ATTRIB_NONE, COLOR_SELECTION};
-            formatter f(def, fb);
-            f.move(xpos, ypos);
-            f.print(ptr + pivot_, charc);
-            f.move(xpos + charc, ypos);
-            f.print(ptr, std::min<int>(pivot_, width_ - charc));
+            assert(length_);
+            pivot_ = pivot_ % length_;
+
+            buffer::row_type& row = fb[ypos];
+            const int width = std::min<int>(width_, static_cast<int>(fb.cols()) - xpos);
+            if (width > 0)
+            {
+                std::copy(cells_.begin() + pivot_, cells_.begin() + pivot_ + width, row.begin() + xpos);
+                // don't leave half of a double width character at either edge.
+                if (row[xpos].value == CELL_WIDE_TAIL)
+                    row[xpos].value = ' ';
+                if (cells_[(pivot_ + width) % length_].value == CELL_WIDE_TAIL)
+                    row[xpos + width - 1].value = ' ';
+            }
             ++pivot_;
         }
         void reset()
         {
-            pivot_ = 0;
-            wait_  = 0;
-            line_.clear();
+            pivot_  = 0;
+            wait_   = 0;
+            length_ = 0;
         }
         void set(const std::string& line, int width)
         {
-            line_ = line;
-            if (static_cast<int>(line.length()) < width)
+            // expand the line to meet the full space and render it twice.
+            // the cell array keeps its capacity between lines.
+            const int cols   = static_cast<int>(utf8_width(line.data(), line.size()));
+            const int length = std::max<int>(cols, width);
+            const cell def   = {' ', ATTRIB_NONE, COLOR_SELECTION, 0, 0};
+            cells_.assign(length * 2, def);
+            const char* str = line.data();
+            const char* end = str + line.size();
+            int x = 0;
+            while (str < end)
             {
-                // simply expand the string to meet the full space
-                std::stringstream ss;
-                ss << line;
-                ss << std::setw(width - line.length()) << std::setfill(' ') << "";
-                line_ = ss.str();
+                const int cp = utf8_decode(str, end);
+                const int w  = char_width(cp);
+                if (w == 0)
+                    continue;
+                cells_[x].value = cp;
+                if (w == 2)
+                    cells_[x + 1].value = CELL_WIDE_TAIL;
+                x += w;
             }
-            width_ = width;
+            std::copy(cells_.begin(), cells_.begin() + length, cells_.begin() + length);
+            length_ = length;
+            width_  = width;
         }
         bool is_set() const
         {
-            return !line_.empty();
+            return length_ != 0;
         }
         bool is_idle(int elapsed)
         {
@@ -104,17 +127,28 @@ namespace cli
                 // do not start to scroll immediately but wait for the idle treshold
                 // to expire before scrolling
                 wait_ += elapsed;
-                return true;
+                if (wait_ < idle_treshold_)
+                    return true;
             }
             return false;
         }
+        // Get the time until the next scroll step.
+        int next_frame() const
+        {
+            if (!enabled_) return -1;
+            if (wait_ < idle_treshold_)
+                return idle_treshold_ - wait_;
+            return frame_interval_;
+        }
     private:
         bool enabled_;
         int  idle_treshold_;
+        int  frame_interval_;
         int  pivot_;
         int  wait_;
         int  width_;
-        std::string line_;
+        int  length_;
+        std::vector<cell> cells_;
     };
 
 
@@ -128,6 +162,7 @@ namespace cli
         inline void set(const std::string&, int) {}
         inline bool is_set() const { return true; }
         inline bool is_idle(int ) const { return true; }
+        inline int  next_frame() const { return -1; }
     private:
     };
 
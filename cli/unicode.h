@@ -0,0 +1,226 @@
+//
+// Copyright (c) 2007 Sami Visnen
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+#include "config.h"
+
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+
+namespace cli
+{
+    // UTF-8 support. Strings are UTF-8 and every cell holds a single
+    // Unicode code point. Double width (East Asian wide and fullwidth)
+    // characters take two cells, the second of which holds CELL_WIDE_TAIL.
+    // Zero width characters such as combining marks have no cell of their
+    // own and are dropped.
+
+    // Replacement for invalid UTF-8 sequences.
+    enum { UNICODE_REPLACEMENT = 0xFFFD };
+
+    // Check whether the bytes are all ASCII. Checks 8 bytes at a time.
+    inline
+    bool is_ascii(const char* s, size_t len)
+    {
+        const unsigned long long high = 0x8080808080808080ull;
+        size_t i = 0;
+        for (; i + 16 <= len; i += 16)
+        {
+            unsigned long long a, b;
+            std::memcpy(&a, s + i, 8);
+            std::memcpy(&b, s + i + 8, 8);
+            if ((a | b) & high)
+                return false;
+        }
+        unsigned char bits = 0;
+        for (; i<len; ++i)
+            bits |= static_cast<unsigned char>(s[i]);
+        return !(bits & 0x80);
+    }
+
+    // Decode the code point at s and advance s past it. 
+    // Invalid or truncated sequences decode to UNICODE_REPLACEMENT
+    // and consume a single byte.
+    inline
+    int utf8_decode(const char*& s, const char* end)
+    {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(s);
+        const unsigned lead = p[0];
+        if (lead < 0x80)
+        {
+            ++s;
+            return lead;
+        }
+        int len = 0;
+        unsigned cp = 0;
+        unsigned min = 0;
+        if ((lead & 0xE0) == 0xC0)
+        {
+            len = 2; cp = lead & 0x1F; min = 0x80;
+        }
+        else if ((lead & 0xF0) == 0xE0)
+        {
+            len = 3; cp = lead & 0x0F; min = 0x800;
+        }
+        else if ((lead & 0xF8) == 0xF0)
+        {
+            len = 4; cp = lead & 0x07; min = 0x10000;
+        }
+        if (len == 0 || end - s < len)
+        {
+            ++s;
+            return UNICODE_REPLACEMENT;
+        }
+        for (int i=1; i<len; ++i)
+        {
+            if ((p[i] & 0xC0) != 0x80)
+            {
+                ++s;
+                return UNICODE_REPLACEMENT;
+            }
+            cp = (cp << 6) | (p[i] & 0x3F);
+        }
+        // reject overlong forms, surrogates and out of range values.
+        if (cp < min || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+        {
+            ++s;
+            return UNICODE_REPLACEMENT;
+        }
+        s += len;
+        return static_cast<int>(cp);
+    }
+
+    // Encode the code point into out which must have room for 4 bytes.
+    // Returns the number of bytes written.
+    inline
+    int utf8_encode(int cp, char* out)
+    {
+        if (cp < 0 || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+            cp = UNICODE_REPLACEMENT;
+        if (cp < 0x80)
+        {
+            out[0] = static_cast<char>(cp);
+            return 1;
+        }
+        if (cp < 0x800)
+        {
+            out[0] = static_cast<char>(0xC0 | (cp >> 6));
+            out[1] = static_cast<char>(0x80 | (cp & 0x3F));
+            return 2;
+        }
+        if (cp < 0x10000)
+        {
+            out[0] = static_cast<char>(0xE0 | (cp >> 12));
+            out[1] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out[2] = static_cast<char>(0x80 | (cp & 0x3F));
+            return 3;
+        }
+        out[0] = static_cast<char>(0xF0 | (cp >> 18));
+        out[1] = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out[2] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out[3] = static_cast<char>(0x80 | (cp & 0x3F));
+        return 4;
+    }
+
+    namespace detail {
+        struct unicode_range {
+            int first;
+            int last;
+        };
+
+        inline
+        bool unicode_range_less(const unicode_range& range, int cp)
+        {
+            return range.last < cp;
+        }
+
+        template<size_t N>
+        bool in_table(const unicode_range (&table)[N], int cp)
+        {
+            if (cp < table[0].first || cp > table[N-1].last)
+                return false;
+            const unicode_range* it = std::lower_bound(table, table + N, cp, unicode_range_less);
+            return it != table + N && cp >= it->first;
+        }
+
+        // East Asian wide and fullwidth characters.
+        const unicode_range wide_chars[] = {
+            {0x1100, 0x115F}, {0x231A, 0x231B}, {0x2329, 0x232A}, {0x23E9, 0x23EC},
+            {0x23F0, 0x23F0}, {0x23F3, 0x23F3}, {0x25FD, 0x25FE}, {0x2614, 0x2615},
+            {0x2648, 0x2653}, {0x267F, 0x267F}, {0x2693, 0x2693}, {0x26A1, 0x26A1},
+            {0x26AA, 0x26AB}, {0x26BD, 0x26BE}, {0x26C4, 0x26C5}, {0x26CE, 0x26CE},
+            {0x26D4, 0x26D4}, {0x26EA, 0x26EA}, {0x26F2, 0x26F3}, {0x26F5, 0x26F5},
+            {0x26FA, 0x26FA}, {0x26FD, 0x26FD}, {0x2705, 0x2705}, {0x270A, 0x270B},
+            {0x2728, 0x2728}, {0x274C, 0x274C}, {0x274E, 0x274E}, {0x2753, 0x2755},
+            {0x2757, 0x2757}, {0x2795, 0x2797}, {0x27B0, 0x27B0}, {0x27BF, 0x27BF},
+            {0x2B1B, 0x2B1C}, {0x2B50, 0x2B50}, {0x2B55, 0x2B55}, {0x2E80, 0x303E},
+            {0x3041, 0x33FF}, {0x3400, 0x4DBF}, {0x4E00, 0x9FFF}, {0xA000, 0xA4CF},
+            {0xA960, 0xA97F}, {0xAC00, 0xD7A3}, {0xF900, 0xFAFF}, {0xFE10, 0xFE19},
+            {0xFE30, 0xFE6F}, {0xFF00, 0xFF60}, {0xFFE0, 0xFFE6}, {0x16FE0, 0x16FE4},
+            {0x17000, 0x18CD5}, {0x1B000, 0x1B2FB}, {0x1F004, 0x1F004}, {0x1F0CF, 0x1F0CF},
+            {0x1F18E, 0x1F18E}, {0x1F191, 0x1F19A}, {0x1F200, 0x1F202}, {0x1F210, 0x1F23B},
+            {0x1F240, 0x1F248}, {0x1F250, 0x1F251}, {0x1F260, 0x1F265}, {0x1F300, 0x1F64F},
+            {0x1F680, 0x1F6FF}, {0x1F7E0, 0x1F7EB}, {0x1F900, 0x1F9FF}, {0x1FA70, 0x1FAFF},
+            {0x20000, 0x2FFFD}, {0x30000, 0x3FFFD}
+        };
+
+        // Combining marks and other zero width characters.
+        const unicode_range zero_width_chars[] = {
+            {0x0300, 0x036F}, {0x0483, 0x0489}, {0x0591, 0x05BD}, {0x0610, 0x061A},
+            {0x064B, 0x065F}, {0x1AB0, 0x1AFF}, {0x1DC0, 0x1DFF}, {0x200B, 0x200F},
+            {0x20D0, 0x20FF}, {0xFE00, 0xFE0F}, {0xFE20, 0xFE2F}, {0xFEFF, 0xFEFF},
+            {0xE0100, 0xE01EF}
+        };
+    } // detail
+
+    // Get the number of cells taken by the code point, 0, 1 or 2.
+    inline
+    int char_width(int cp)
+    {
+        if (cp < 0x300)
+            return 1;
+        if (detail::in_table(detail::zero_width_chars, cp))
+            return 0;
+        if (detail::in_table(detail::wide_chars, cp))
+            return 2;
+        return 1;
+    }
+
+    // Get the number of cells needed to display the string.
+    inline
+    size_t utf8_width(const char* s, size_t len)
+    {
+        if (is_ascii(s, len))
+            return len;
+        size_t width = 0;
+        const char* end = s + len;
+        while (s < end)
+            width += char_width(utf8_decode(s, end));
+        return width;
+    }
+
+} // cli
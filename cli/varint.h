@@ -0,0 +1,104 @@
+//
+// Copyright (c) 2007 Sami Visnen
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#pragma once
+
+#include "config.h"
+
+#include <istream>
+#include <ostream>
+
+namespace cli
+{
+    // Variable length integer encoding for the binary file formats.
+    // Unsigned integers are written 7 bits at a time, low bits first, 
+    // with the high bit set on every byte except the last. Signed integers
+    // are zigzag encoded first so that small negative values stay small.
+
+    inline
+    void write_varint(std::ostream& out, unsigned long long value)
+    {
+        while (value >= 0x80)
+        {
+            out.put(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        out.put(static_cast<char>(value));
+    }
+
+    inline
+    bool read_varint(std::istream& in, unsigned long long& value)
+    {
+        value = 0;
+        for (int shift=0; shift<64; shift+=7)
+        {
+            const int byte = in.get();
+            if (byte == std::char_traits<char>::eof())
+                return false;
+            value |= static_cast<unsigned long long>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    inline
+    void write_svarint(std::ostream& out, long long value)
+    {
+        write_varint(out, (static_cast<unsigned long long>(value) << 1) ^ static_cast<unsigned long long>(value >> 63));
+    }
+
+    inline
+    bool read_svarint(std::istream& in, long long& value)
+    {
+        unsigned long long u = 0;
+        if (!read_varint(in, u))
+            return false;
+        value = static_cast<long long>(u >> 1) ^ -static_cast<long long>(u & 1);
+        return true;
+    }
+
+    // Convenience for reading into an int.
+    inline
+    bool read_varint(std::istream& in, int& value)
+    {
+        unsigned long long u = 0;
+        if (!read_varint(in, u))
+            return false;
+        value = static_cast<int>(u);
+        return true;
+    }
+
+    inline
+    bool read_svarint(std::istream& in, int& value)
+    {
+        long long s = 0;
+        if (!read_svarint(in, s))
+            return false;
+        value = static_cast<int>(s);
+        return true;
+    }
+
+} // cli
@@ -148,7 +148,7 @@ namespace cli
             typedef typename Database::value     value;
             typedef typename Database::converter converter;
 
-            cell def = {' ', ATTRIB_NONE, COLOR_NONE};
+            cell def = {' ', ATTRIB_NONE, COLOR_NONE, 0, 0};
             formatter f(def, fb);
             f.fillblank(true);
 
@@ -60,6 +60,10 @@ namespace cli
         // The keydown function should return true if the key event was handled.
         // Otherwise it should return false.
         virtual bool keydown(int raw, int vk) { return false; }
+
+        // Process a block of pasted text at once. The text is not NUL terminated.
+        // The function should return true if the text was accepted.
+        virtual bool paste(const char* text, size_t len) { return false; }
     
         // Animate this widget. A widget that supports some kind of animation
         // should return a rectangle that describes the area which it has updated in 
@@ -70,6 +74,16 @@ namespace cli
             rect ret = {};
             return ret;
         }
+
+        // Get the number of milliseconds until the widget next needs to animate.
+        // The window only calls animate once this time has elapsed and then
+        // passes all of the elapsed time at once. -1 means that the widget
+        // has nothing to animate. Widgets that implement animate need to
+        // implement this as well, the default is to never animate.
+        virtual int next_frame() const
+        {
+            return -1;
+        }
         
         // Erase are from the frame buffer. This is used when a widget
         // displays data only in some special circumstances (such as a menu or a drop down list)
@@ -82,6 +96,21 @@ namespace cli
             return ret;
         }
 
+        // Restore the area covered by a closed popup from a backing store
+        // (see save_under) instead of erasing it. This is called before erase().
+        // The function should return the restored rectangle. An empty rectangle
+        // means that there is nothing to restore and the area returned by erase()
+        // is cleared and the widgets underneath are redrawn.
+        virtual rect restore(buffer& fb)
+        {
+            rect ret = {};
+            return ret;
+        }
+
+        // Notify the widget that other widgets have drawn into the rectangle.
+        // A popup needs to drop its backing store if it intersects the rectangle.
+        virtual void overdrawn(const rect& rc) {}
+
         // Get the validity of the widget. If the widget is valid
         // it doesn't need to draw itself. If it is not valid, it needs to draw.
         virtual bool is_valid() const { return valid_; }
@@ -114,6 +143,12 @@ namespace cli
         {
             return ypos_;
         }
+
+        // Get the rectangle covered by the widget. Relative to the frame buffer.
+        inline rect bounds() const
+        {
+            return make_rect(xpos_, ypos_, width(), height());
+        }
         
     protected:
         widget(int x, int y) : xpos_(x), ypos_(y), valid_(false) {}
@@ -27,6 +27,8 @@
 
 #include "widget.h"
 #include "window.h"
+#include "winstack.h"
+#include "staticwindow.h"
 #include "text.h"
 #include "list.h"
 #include "table.h"
@@ -43,6 +45,10 @@
 #include "singlesel.h"
 #include "multisel.h"
 #include "dynsel.h"
+#include "rangesel.h"
+#include "finder.h"
+#include "filterview.h"
+#include "sortview.h"
 
 
  
@@ -31,22 +31,42 @@
 #include "menu.h"
 #include <algorithm>
 #include <vector>
+#include <chrono>
 #include <cassert>
 
 namespace cli
 {
 
+namespace {
+    long long now_us()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+} // namespace
+
 window::window() : 
+    clock_(0),
+    retained_(false),
     focused_(NULL),
     menu_(NULL),
     can_close_(false), 
     is_valid_(false), 
-    is_open_(false)
+    is_open_(false),
+    stats_on_(false)
 {
     cursor_.x = 0;
     cursor_.y = 0;
     cursor_.v = false;
     memset(&rc_erase_, 0, sizeof(rc_erase_));
+    memset(&allocs_, 0, sizeof(allocs_));
+    stats_.erase_us    = 0;
+    stats_.draw_us     = 0;
+    stats_.animate_us  = 0;
+    stats_.drawn       = 0;
+    stats_.skipped     = 0;
+    stats_.dirty_cells = 0;
+    stats_.bytes_out   = 0;
 }
 
 window::~window()
@@ -56,6 +76,8 @@ window::~window()
 void window::add(widget* w)
 {
     circus_.push_back(w);
+    stamps_.push_back(clock_);
+    surfaces_.push_back(buffer());
     if (is_open_)
     {
         w->invalidate(true);
@@ -76,6 +98,8 @@ void window::add(menu* m)
     if (m)
     {
         circus_.push_back(m);
+        stamps_.push_back(clock_);
+        surfaces_.push_back(buffer());
         if (is_open_)
         {
             menu_->invalidate(true);
@@ -88,21 +112,24 @@ void window::add(menu* m)
 
 void window::rem(widget* w)
 {
-    circus_.erase(remove(circus_.begin(), circus_.end(), w), circus_.end());
+    for (std::vector<widget*>::size_type i=0; i<circus_.size(); )
+    {
+        if (circus_[i] == w)
+        {
+            circus_.erase(circus_.begin() + i);
+            stamps_.erase(stamps_.begin() + i);
+            surfaces_.erase(surfaces_.begin() + i);
+        }
+        else ++i;
+    }
     if (is_open_ && evterase)
     {
         if (focused_ == w)
         {
             // todo: find next focused widget
         }
-        rect rc   = {};
-        rc.top    = w->ypos();
-        rc.left   = w->xpos();
-        rc.right  = rc.left + w->width();
-        rc.bottom = rc.top + w->height();
-
         // combine this invalid rectangle with already existing rectangle
-        rc_erase_ = rect_union(rc_erase_, rc);
+        rc_erase_ = rect_union(rc_erase_, w->bounds());
         if (evtdraw)
             evtdraw(this);
     }
@@ -186,6 +213,27 @@ const cursor& window::curs() const
 
 rect window::draw(buffer& fb) 
 {
+    alloc_scope allocs(allocs_.draw);
+
+    const long long start = stats_on_ ? now_us() : 0;
+    if (stats_on_)
+    {
+        stats_.drawn     = 0;
+        stats_.skipped   = 0;
+        stats_.bytes_out = 0;
+        stats_.widgets.clear();
+    }
+
+    // popups put back the cells underneath them. whatever
+    // they can't restore is erased and redrawn below.
+    rect restored = {};
+    for (std::vector<widget*>::iterator it = circus_.begin(); it != circus_.end(); ++it)
+    {
+        rect r = (*it)->restore(fb);
+        if (!rect_is_empty(r))
+            restored = rect_union(restored, r);
+    }
+
     rect erase = {};
     if (evterase)
     {
@@ -199,80 +247,84 @@ rect window::draw(buffer& fb)
         erase = rect_union(rc_erase_, erase);
         evterase(this, erase);
     }
+    if (stats_on_)
+        stats_.erase_us = static_cast<int>(now_us() - start);
     
     // todo: should the validation be bclilt in the widgets as well?
     // seeing that the invalidation is.
     rect rc = {};
-    for (std::vector<widget*>::iterator it = circus_.begin(); it != circus_.end(); ++it)
+    if (retained_)
+        rc = compose(fb, rect_union(erase, restored));
+    for (std::vector<widget*>::size_type i=0; i<circus_.size() && !retained_; ++i)
     {
-        widget* w = *it;
+        widget* w = circus_[i];
         if (!rect_is_empty(erase))
         {
             // if this widgets rectangle falls within the erased rectangle
             // we have a need to believe that it needs to be redrawn
-            rect r   = {};
-            r.top    = w->ypos();
-            r.left   = w->xpos();
-            r.right  = r.left + w->width();
-            r.bottom = r.top  + w->height();
-            if (rect_intersects_rect(r, erase))
+            if (rect_intersects_rect(w->bounds(), erase))
                 w->invalidate(true);
         }
 
-        if (w->is_valid() || w == focused_ || (w == menu_ && menu_->is_open()))
+        if (w == focused_ || (w == menu_ && menu_->is_open()))
+            continue;
+        if (w->is_valid())
+        {
+            if (stats_on_)
+                ++stats_.skipped;
             continue;
+        }
 
-        rect r = w->draw(fb);
-        w->validate();
+        rect r = draw_widget(w, fb);
         rc = rect_union(rc, r);
+        // a redraw restarts any animation wait
+        stamps_[i] = clock_;
     }
     // draw the focused widget last. This allows to do simple things
     // like have a menu open on top of other widgets. (or a dropdown list, etc)
     // todo: should there be z ordering?
-    if (focused_)
+    if (focused_ && retained_)
+    {
+        cursor_.v = false;
+        focused_->set_cursor(cursor_);
+    }
+    else if (focused_)
     {
         // if the focused widget is not valid or then some widget drew into
         // a rectangle that intersects with the rectangle of the focused
         // widget it needs to be redrawn.
-        // so calculate the focused rect here.
         if (focused_->is_valid())
         {
-            rect frc   = {};
-            frc.top    = focused_->ypos();
-            frc.left   = focused_->xpos();
-            frc.right  = frc.left + focused_->width();
-            frc.bottom = frc.top  + focused_->height();
-            if (rect_intersects_rect(frc, rc))
+            if (rect_intersects_rect(focused_->bounds(), rc))
                 focused_->invalidate(true);
         }
         cursor_.v = false;
         if (!focused_->is_valid())
         {
-            rect r = focused_->draw(fb);
-            focused_->validate();
+            rect r = draw_widget(focused_, fb);
             rc = rect_union(rc, r);
+            restart(focused_);
         }
+        else if (stats_on_)
+            ++stats_.skipped;
         focused_->set_cursor(cursor_);
     }
 
-    if (menu_ && menu_->is_open())
+    // in retained mode the menu bar needs to go on top of the surfaces as well.
+    if (menu_ && (menu_->is_open() || retained_))
     {
+        menu_->overdrawn(rc);
         if (menu_->is_valid())
         {
-            rect mrc   = {};
-            mrc.top    = menu_->ypos();
-            mrc.left   = menu_->xpos();
-            mrc.right  = mrc.left + menu_->width();
-            mrc.bottom = mrc.top  + menu_->height();
-            if (rect_intersects_rect(mrc, rc))
+            if (rect_intersects_rect(menu_->bounds(), rect_union(rc, restored)))
                 menu_->invalidate(true);
         }
         if (!menu_->is_valid())
         {
-            rect r = menu_->draw(fb);
-            menu_->validate();
+            rect r = draw_widget(menu_, fb);
             rc = rect_union(rc, r);
-            if (cursor_.v)
+            restart(menu_);
+            if (cursor_.v && menu_->is_open())
             {
                 // need to hide cursor if it happens to intersect with the  drop down menu
                 if (cursor_.x >= rc.left && cursor_.x <= rc.right)
@@ -285,20 +337,190 @@ rect window::draw(buffer& fb)
     is_valid_ = true;
     memset(&rc_erase_, 0, sizeof(rect));
     
-    return rect_union(rc, erase);
+    rc = rect_union(rc, erase);
+    rc = rect_union(rc, restored);
+    if (stats_on_)
+    {
+        stats_.draw_us     = static_cast<int>(now_us() - start);
+        stats_.dirty_cells = rect_is_empty(rc) ? 0 : (rc.right - rc.left) * (rc.bottom - rc.top);
+        draw_times_.add(stats_.draw_us);
+    }
+    return rc;
+}
 
+rect window::draw_widget(widget* w, buffer& fb)
+{
+    const long long start = stats_on_ ? now_us() : 0;
+    rect r = w->draw(fb);
+    w->validate();
+    if (stats_on_)
+    {
+        frame_stats::widget_time t = {w, static_cast<int>(now_us() - start)};
+        stats_.widgets.push_back(t);
+        ++stats_.drawn;
+    }
+    return r;
+}
+
+rect window::compose(buffer& fb, const rect& damage)
+{
+    // render the invalid widgets. the menu is drawn later.
+    rect dirty = damage;
+    for (std::vector<widget*>::size_type i=0; i<circus_.size(); ++i)
+    {
+        widget* w = circus_[i];
+        if (w == menu_)
+            continue;
+        if (w->is_valid())
+        {
+            if (stats_on_)
+                ++stats_.skipped;
+            continue;
+        }
+        dirty = rect_union(dirty, render(i, fb));
+        // a redraw restarts any animation wait
+        stamps_[i] = clock_;
+    }
+    if (!rect_is_empty(dirty))
+        blit_all(fb, dirty);
+    return dirty;
+}
+
+rect window::render(std::vector<widget*>::size_type i, const buffer& fb)
+{
+    widget* w = circus_[i];
+    const int x = w->xpos();
+    const int y = w->ypos();
+    const int cols = std::min(w->width(), static_cast<int>(fb.cols()) - x);
+    const int rows = std::min(w->height(), static_cast<int>(fb.rows()) - y);
+    buffer& surface = surfaces_[i];
+    if (x < 0 || y < 0 || cols <= 0 || rows <= 0)
+    {
+        // nothing visible
+        surface.resize(0, 0);
+        w->validate();
+        rect rc = {};
+        return rc;
+    }
+    if (surface.rows() != static_cast<size_t>(rows) || surface.cols() != static_cast<size_t>(cols))
+    {
+        surface.resize(rows, cols);
+        surface.clear();
+    }
+    // the widget draws at the origin of its surface.
+    w->position(0, 0);
+    draw_widget(w, surface);
+    w->position(x, y);
+    return make_rect(x, y, cols, rows);
+}
+
+void window::blit(const widget* w, buffer& fb, const rect& dirty) const
+{
+    const std::vector<widget*>::size_type i = std::find(circus_.begin(), circus_.end(), w) - circus_.begin();
+    assert(i < circus_.size());
+    const buffer& surface = surfaces_[i];
+    if (!surface.rows())
+        return;
+
+    const int x = w->xpos();
+    const int y = w->ypos();
+    const int left   = std::max(x, dirty.left);
+    const int top    = std::max(y, dirty.top);
+    const int right  = std::min(x + static_cast<int>(surface.cols()), dirty.right);
+    const int bottom = std::min(y + static_cast<int>(surface.rows()), dirty.bottom);
+    for (int row=top; row<bottom; ++row)
+    {
+        const buffer::row_type& src = surface[row - y];
+        std::copy(src.begin() + (left - x), src.begin() + (right - x), fb[row].begin() + left);
+    }
+}
+
+void window::blit_all(buffer& fb, const rect& dirty) const
+{
+    for (std::vector<widget*>::size_type i=0; i<circus_.size(); ++i)
+    {
+        const widget* w = circus_[i];
+        if (w != focused_ && w != menu_)
+            blit(w, fb, dirty);
+    }
+    if (focused_)
+        blit(focused_, fb, dirty);
+}
+
+rect window::animate_retained(buffer& fb)
+{
+    // animate the widgets in their surfaces and composite 
+    // the animated areas. the menu bar goes on top again.
+    rect ret = {};
+    for (std::vector<widget*>::size_type i=0; i<circus_.size(); ++i)
+    {
+        widget* w = circus_[i];
+        if (w == menu_ || !surfaces_[i].rows())
+            continue;
+        if (!is_due(i))
+            continue;
+
+        const int x = w->xpos();
+        const int y = w->ypos();
+        w->position(0, 0);
+        rect rc = w->animate(surfaces_[i], static_cast<int>(clock_ - stamps_[i]));
+        w->position(x, y);
+        stamps_[i] = clock_;
+        if (rect_is_empty(rc))
+            continue;
+        rc.left   += x;
+        rc.right  += x;
+        rc.top    += y;
+        rc.bottom += y;
+        ret = rect_union(ret, rc);
+    }
+    if (rect_is_empty(ret))
+        return ret;
+
+    blit_all(fb, ret);
+    if (menu_)
+    {
+        menu_->overdrawn(ret);
+        if (rect_intersects_rect(menu_->bounds(), ret))
+        {
+            menu_->invalidate(true);
+            ret = rect_union(ret, menu_->draw(fb));
+            menu_->validate();
+        }
+    }
+    return ret;
 }
 
 rect window::animate(buffer& fb, int elapsed)
 {
+    alloc_scope allocs(allocs_.animate);
+
+    const long long start = stats_on_ ? now_us() : 0;
+    clock_ += elapsed;
+    if (retained_)
+    {
+        rect ret = animate_retained(fb);
+        if (stats_on_)
+        {
+            stats_.animate_us = static_cast<int>(now_us() - start);
+            animate_times_.add(stats_.animate_us);
+        }
+        return ret;
+    }
+
+    // only the widgets whose next frame is due are animated. 
+    // each widget gets all the time elapsed since it was last animated.
     rect ret = {};
-    for (std::vector<widget*>::iterator it = circus_.begin(); it != circus_.end(); ++it)
+    for (std::vector<widget*>::size_type i=0; i<circus_.size(); ++i)
     {
-        widget* w = *it;
+        widget* w = circus_[i];
         if (w == focused_ || w == menu_)
             continue;
+        if (!is_due(i))
+            continue;
 
-        rect rc = w->animate(fb, elapsed);
+        rect rc = w->animate(fb, static_cast<int>(clock_ - stamps_[i]));
+        stamps_[i] = clock_;
         if (!rect_is_empty(rc))
             ret = rect_union(ret, rc);
     }
@@ -308,30 +530,77 @@ rect window::animate(buffer& fb, int elapsed)
         widget* wid = special[i];
         if (!wid)
             continue;
-        rect r = wid->animate(fb, elapsed);
+        wid->overdrawn(ret);
+        const std::vector<widget*>::size_type pos = std::find(circus_.begin(), circus_.end(), wid) - circus_.begin();
+        assert(pos < circus_.size());
+        rect r = {};
+        if (is_due(pos))
+        {
+            r = wid->animate(fb, static_cast<int>(clock_ - stamps_[pos]));
+            stamps_[pos] = clock_;
+        }
         if (rect_is_empty(r))
         {
             // the widget didnt do any animations. in other words it didnt update
             // its rectangle in any way. Thus we must check if some other widget animated
             // into this rectangle. 
-            r.top    = wid->ypos();
-            r.left   = wid->xpos();
-            r.right  = r.left + wid->width();
-            r.bottom = r.top  + wid->height();
-            if (rect_intersects_rect(r, ret))
+            if (rect_intersects_rect(wid->bounds(), ret))
             {
                 // yes, animation messed up, need to redraw.
                 wid->invalidate(true);
                 r = wid->draw(fb);
                 ret = rect_union(ret, r);
+                stamps_[pos] = clock_;
             }
         }
         else
             ret = rect_union(ret, r);
     }
+    if (stats_on_)
+    {
+        stats_.animate_us = static_cast<int>(now_us() - start);
+        animate_times_.add(stats_.animate_us);
+    }
     return ret;
 }
 
+int window::next_frame() const
+{
+    int next = -1;
+    for (std::vector<widget*>::size_type i=0; i<circus_.size(); ++i)
+    {
+        const int frame = circus_[i]->next_frame();
+        if (frame < 0)
+            continue;
+        const long long left = std::max<long long>(0, stamps_[i] + frame - clock_);
+        if (next == -1 || left < next)
+            next = static_cast<int>(left);
+    }
+    return next;
+}
+
+bool window::is_due(std::vector<widget*>::size_type i)
+{
+    const int frame = circus_[i]->next_frame();
+    if (frame < 0)
+    {
+        // nothing to animate, so the wait starts over
+        // once the widget has something to animate again.
+        stamps_[i] = clock_;
+        return false;
+    }
+    return clock_ - stamps_[i] >= frame;
+}
+
+void window::restart(const widget* w)
+{
+    for (std::vector<widget*>::size_type i=0; i<circus_.size(); ++i)
+    {
+        if (circus_[i] == w)
+            stamps_[i] = clock_;
+    }
+}
+
 
 void window::invalidate()
 {
@@ -347,6 +616,8 @@ void window::invalidate()
 
 bool window::keydown(int raw, int vk)
 {
+    alloc_scope allocs(allocs_.keydown);
+
     if (vk == VK_KILL_WINDOW && menu_ && menu_->is_open())
     {
         menu_->close();
@@ -417,7 +688,25 @@ bool window::keydown(int raw, int vk)
         if (!ret)
             return false;
     }
+    input_done();
+    return true;
+}
+
+bool window::paste(const char* text, size_t len)
+{
+    alloc_scope allocs(allocs_.keydown);
+
+    if (menu_ && menu_->is_open())
+        return false;
+    if (!focused_ || !focused_->paste(text, len))
+        return false;
+
+    input_done();
+    return true;
+}
 
+void window::input_done()
+{
     // see if some widgets become invalid as a result of input handling
     for (std::vector<widget*>::size_type i(0); i<circus_.size(); ++i)
     {
@@ -432,7 +721,6 @@ bool window::keydown(int raw, int vk)
         if (evtdraw)   evtdraw(this);
         if (evtcursor) evtcursor(this, cursor_);
     }
-    return true;
 }
 
 void window::close()
@@ -489,5 +777,53 @@ void window::can_close_on_vk(bool val)
     can_close_ = val;
 }
 
+void window::retained(bool val)
+{
+    if (val == retained_)
+        return;
+    retained_ = val;
+    if (!val)
+    {
+        for (std::vector<buffer>::iterator it = surfaces_.begin(); it != surfaces_.end(); ++it)
+            it->resize(0, 0);
+    }
+    invalidate();
+}
+
+const window::alloc_report& window::allocations() const
+{
+    return allocs_;
+}
+
+void window::record_stats(bool val)
+{
+    stats_on_ = val;
+    if (!val)
+    {
+        draw_times_.clear();
+        animate_times_.clear();
+    }
+}
+
+const frame_stats& window::stats() const
+{
+    return stats_;
+}
+
+const rolling_histogram& window::draw_times() const
+{
+    return draw_times_;
+}
+
+const rolling_histogram& window::animate_times() const
+{
+    return animate_times_;
+}
+
+void window::record_output(int bytes)
+{
+    stats_.bytes_out = bytes;
+}
+
 } // cli
 
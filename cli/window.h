@@ -30,17 +30,28 @@
 #include <vector>
 #include <functional>
 #include "common.h"
+#include "buffer.h"
+#include "instrument.h"
+#include "framestats.h"
 
 namespace cli
 {
     class menu;
     class widget ;
-    class buffer;
 
     // A window object manages a bunch of widgets and gives them a common context and frame.
     class window
     {
     public:
+        // Heap allocations done by the last draw, animate and keydown calls.
+        // These include anything done by the event handlers invoked during the call.
+        // Only counted when the application has installed the allocation hook.
+        struct alloc_report {
+            alloc_stats draw;
+            alloc_stats animate;
+            alloc_stats keydown;
+        };
+
         // Evtdraw event will be invoked when the window is dirty and needs painting.
         // As a response to this event application should call the draw function.
         // Inside the draw function one should be careful not to make any calls to 
@@ -112,6 +123,11 @@ namespace cli
         // rectangles. This is the area that has changed in the the frame buffer
         // and should be transferred to the terminal.
         rect animate(buffer& fb, int elapsed);
+
+        // Get the number of milliseconds until the next widget animation is due.
+        // The application can wait for input for this long before calling animate.
+        // Returns -1 if no widget has anything to animate.
+        int next_frame() const;
             
         // Invalidate all widgets. Will force complete redraw.            
         void invalidate();
@@ -125,6 +141,11 @@ namespace cli
         // the draw event will be invoked.
         bool keydown(int raw, int vk);
 
+        // Process pasted text. The text is given to the focused widget in one
+        // go and the draw event is invoked at most once. Returns true if the
+        // focused widget accepted the text.
+        bool paste(const char* text, size_t len);
+
         // Set the close flag on this window.
         void close(); 
 
@@ -138,10 +159,53 @@ namespace cli
             
         // Disable/enable VK_KILL_WINDOW.
         void can_close_on_vk(bool val);
+
+        // Enable or disable retained mode. Disabled by default.
+        // In retained mode every widget draws into a surface of its own only
+        // when it is invalid, and the window composites the surfaces into the
+        // frame buffer in z order (the focused widget on top). Erasing or 
+        // drawing over a widget then only costs a copy from its surface
+        // instead of a redraw. The menu always draws into the frame buffer.
+        void retained(bool val);
+
+        // Get the allocations done by the last draw, animate and keydown calls.
+        const alloc_report& allocations() const;
+
+        // Enable or disable recording of frame statistics. Disabled by default.
+        void record_stats(bool val);
+
+        // Get the statistics of the last frame.
+        const frame_stats& stats() const;
+
+        // Get the draw and animate times of the recent frames in microseconds.
+        const rolling_histogram& draw_times() const;
+        const rolling_histogram& animate_times() const;
+
+        // Record the number of bytes the terminal backend output for the last 
+        // frame, such as the value returned by term_draw_buffer. 
+        void record_output(int bytes);
     private:     
+        bool is_due(std::vector<widget*>::size_type i);
+        rect draw_widget(widget* w, buffer& fb);
+        rect compose(buffer& fb, const rect& damage);
+        rect render(std::vector<widget*>::size_type i, const buffer& fb);
+        rect animate_retained(buffer& fb);
+        void blit(const widget* w, buffer& fb, const rect& dirty) const;
+        void blit_all(buffer& fb, const rect& dirty) const;
+        void restart(const widget* w);
+        void input_done();
         
         std::vector<widget*> circus_;
 
+        // animation time stamps of the widgets in circus_.
+        // the stamp is the clock time when the widget was last animated or drawn.
+        std::vector<long long> stamps_;
+        long long clock_;
+
+        // retained mode surfaces of the widgets in circus_.
+        std::vector<buffer> surfaces_;
+        bool retained_;
+
         widget* focused_; 
         menu*   menu_;
         bool can_close_;
@@ -149,6 +213,11 @@ namespace cli
         bool is_open_;
         cursor cursor_;
         rect rc_erase_;
+        alloc_report allocs_;
+        bool stats_on_;
+        frame_stats stats_;
+        rolling_histogram draw_times_;
+        rolling_histogram animate_times_;
     };
 
 } // cli
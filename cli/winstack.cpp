@@ -0,0 +1,120 @@
+//
+// Copyright (c) 2007 Sami Visnen
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#include "config.h"
+
+#include "winstack.h"
+#include "window.h"
+#include <cassert>
+
+namespace cli
+{
+
+rect window_stack::push(window* w, buffer& fb)
+{
+    assert(w);
+    rect rc = {};
+    if (!stack_.empty() && !stack_.back().wnd->is_valid())
+        rc = stack_.back().wnd->draw(fb);
+
+    stack_.resize(stack_.size() + 1);
+    layer& top = stack_.back();
+    top.wnd   = w;
+    top.below = fb;
+    return rc;
+}
+
+rect window_stack::pop(buffer& fb)
+{
+    assert(!stack_.empty());
+    layer& top = stack_.back();
+
+    const bool resized = top.below.rows() != fb.rows() || 
+        (fb.rows() && top.below.cols() != fb.cols());
+    if (!resized)
+        std::swap(fb, top.below);
+    stack_.pop_back();
+
+    rect rc = {};
+    if (stack_.empty())
+        return rc;
+
+    // the whole frame buffer changed. anything that was
+    // updated while covered is drawn on top of the snapshot.
+    window* under = stack_.back().wnd;
+    rc = make_rect(0, 0, static_cast<int>(fb.cols()), static_cast<int>(fb.rows()));
+    if (resized)
+    {
+        // the snapshot doesn't fit, start over from a blank frame.
+        // invalidating fires evtdraw which may draw the stack already.
+        fb.clear();
+        under->invalidate();
+    }
+    if (!under->is_valid())
+        under->draw(fb);
+    return rc;
+}
+
+window* window_stack::top() const
+{
+    return stack_.empty() ? NULL : stack_.back().wnd;
+}
+
+rect window_stack::draw(buffer& fb)
+{
+    assert(!stack_.empty());
+    return stack_.back().wnd->draw(fb);
+}
+
+rect window_stack::animate(buffer& fb, int elapsed)
+{
+    assert(!stack_.empty());
+    return stack_.back().wnd->animate(fb, elapsed);
+}
+
+bool window_stack::keydown(int raw, int vk)
+{
+    assert(!stack_.empty());
+    return stack_.back().wnd->keydown(raw, vk);
+}
+
+bool window_stack::paste(const char* text, size_t len)
+{
+    assert(!stack_.empty());
+    return stack_.back().wnd->paste(text, len);
+}
+
+bool window_stack::empty() const
+{
+    return stack_.empty();
+}
+
+std::size_t window_stack::size() const
+{
+    return stack_.size();
+}
+
+} // cli
@@ -0,0 +1,91 @@
+//
+// Copyright (c) 2007 Sami Visnen
+//
+// Permission is hereby granted, free of charge, to any person
+// obtaining a copy of this software and associated documentation
+// files (the "Software"), to deal in the Software without
+// restriction, including without limitation the rights to use,
+// copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following
+// conditions:
+//
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+// OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+// HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "config.h"
+
+#include "common.h"
+#include "buffer.h"
+#include <vector>
+
+namespace cli
+{
+    class window;
+
+    // Window_stack manages modal windows (dialogs) on top of each other.
+    // Only the top window receives input and is drawn. Pushing a window 
+    // saves a snapshot of the frame buffer, and popping the window copies
+    // the snapshot back, so the window underneath isn't redrawn at all.
+    // If the window underneath was updated while covered, only its invalid
+    // widgets are redrawn on top of the snapshot.
+    //
+    // The evtdraw handlers of the windows should draw the stack instead of
+    // the window itself so that a covered window doesn't draw over the modal.
+    // The stack doesn't own the windows.
+    class window_stack
+    {
+    public:
+        // Push a window on top of the stack. The frame buffer should hold
+        // the current frame of the top window, if the top window is not valid
+        // it's drawn first. Returns the rectangle drawn in the frame buffer.
+        rect push(window* w, buffer& fb);
+
+        // Pop the top window. The frame buffer is restored to the frame it 
+        // had when the window was pushed. If the frame buffer has been 
+        // resized since then, the frame buffer is cleared and the uncovered
+        // window is redrawn in full instead. Returns the whole frame buffer
+        // as the changed rectangle.
+        rect pop(buffer& fb);
+
+        // Get the top window. NULL if the stack is empty.
+        window* top() const;
+
+        // Draw the top window.
+        rect draw(buffer& fb);
+
+        // Animate the top window.
+        rect animate(buffer& fb, int elapsed);
+
+        // Pass a keypress to the top window.
+        bool keydown(int raw, int vk);
+
+        // Pass pasted text to the top window.
+        bool paste(const char* text, size_t len);
+
+        bool empty() const;
+
+        // Get the number of windows in the stack.
+        std::size_t size() const;
+    private:
+        struct layer {
+            window* wnd;
+            buffer  below;   // the frame before this window was pushed
+        };
+        std::vector<layer> stack_;
+    };
+
+} // cli
@@ -49,6 +49,7 @@
 #include <sstream>
 #include <iomanip>
 #include <fstream>
+#include <chrono>
 
 using namespace cli;
 using namespace std;
@@ -61,7 +62,8 @@ enum application_keys {
     VK_SORT_BY_SIZE,
     VK_SORT_BY_CODE,
     VK_SORT_BY_BLANK,
-    VK_EXPORT
+    VK_EXPORT,
+    VK_FILTER
 };
 
 struct file {
@@ -307,28 +309,26 @@ export_status export_html(const vector<file*>& files, const std::string& file, c
     return EXPORT_SUCCESS;
 }
 
-inline
-bool sort_by_name(const file* one, const file* two)
+// filter predicate for showing only files whose path contains a substring.
+bool path_contains(const file* f, const std::string& str)
 {
-    return one->name < two->name;
+    return f->name.find(str) != std::string::npos;
 }
 
-inline
-bool sort_by_size(const file* one, const file* two)
+// integer sort keys for the table columns.
+long long file_size(const file* f)
 {
-    return one->size > two->size;
+    return f->size;
 }
 
-inline
-bool sort_by_code(const file* one, const file* two)
+long long file_code(const file* f)
 {
-    return one->lines_code > two->lines_code;
+    return f->lines_code;
 }
 
-inline
-bool sort_by_blank(const file* one, const file* two)
+long long file_blank(const file* f)
 {
-    return one->lines_blank > two->lines_blank;
+    return f->lines_blank;
 }
 
 void print_version()
@@ -354,6 +354,7 @@ int map_input(int ch)
         case 'c':                 return VK_SORT_BY_CODE;
         case 'b':                 return VK_SORT_BY_BLANK;
         case 'e':                 return VK_EXPORT;
+        case '/':                 return VK_FILTER;
     }
     return -1;
 }
@@ -362,7 +363,7 @@ void draw_window(cli::window* win, cli::buffer* fb)
 {
     const cli::rect dirty = win->draw(*fb);
 
-    cli::term_draw_buffer(*fb, dirty);
+    win->record_output(cli::term_draw_buffer(*fb, dirty));
 }
 
 int main(int argc, const char* argv[])
@@ -459,6 +460,7 @@ int main(int argc, const char* argv[])
 
         term_init();
         term_init_colors();
+        term_enable_paste(true);
 
         cli::size size = term_get_size();
         assert(size.cols && size.rows);
@@ -470,8 +472,15 @@ int main(int argc, const char* argv[])
         wnd.evtdraw = std::bind(draw_window, 
             std::placeholders::_1, &framebuff);
 
-        basic_table<file_tree_data> list;
+        basic_table<filtered_view<sorted_view<file_tree_data> >,
+            default_single_selection,
+            default_ticker,
+            default_pager,
+            prefix_finder> list;
         list.files = &files;
+        list.intkey(1, file_size);
+        list.intkey(2, file_code);
+        list.intkey(3, file_blank);
         list.addcol(65); // name
         list.addcol(5); // size
         list.addcol(10);  // lines_code
@@ -510,7 +519,7 @@ int main(int argc, const char* argv[])
         text3.settext(ss.str());
 
         ss.str("");
-        ss << "Sort by: n) name s) size c) code b) blank - q) to quit - e) to export";
+        ss << "Sort by: n) name s) size c) code b) blank - /) filter - q) to quit - e) to export";
     
         text4.position(1, size.rows - 1);
         text4.width(size.cols-1);
@@ -526,9 +535,87 @@ int main(int argc, const char* argv[])
 
         bool loop = true;
         bool help = true;
+        bool filter = false;
+        int  sort_column = -1;
+        bool sort_ascending = false;
+        std::string filter_text;
+        chrono::steady_clock::time_point frame_time = chrono::steady_clock::now();
         while (loop)
         {
-            int ch = term_get_key();
+            // wait for input only until the next animation frame is due.
+            // while a sort is running in the background keep polling
+            // for it so that the new order is shown as soon as it's ready.
+            int wait = wnd.next_frame();
+            if (list.sort_pending() && (wait == -1 || wait > 50))
+                wait = 50;
+            int ch = wait == -1 ? term_get_key() : term_wait_key(wait);
+
+            const chrono::steady_clock::time_point now = chrono::steady_clock::now();
+            const int elapsed = static_cast<int>(chrono::duration_cast<chrono::milliseconds>(now - frame_time).count());
+            frame_time = now;
+            const rect animated = wnd.animate(framebuff, elapsed);
+            if (!rect_is_empty(animated))
+                term_draw_buffer(framebuff, animated);
+
+            if (list.sort_poll())
+            {
+                list.refilter();
+                list.reindex();
+                list.selpos(0);
+                wnd.update(&list);
+                if (!help && !filter)
+                {
+                    text4.settext(ss.str());
+                    wnd.update(&text4);
+                }
+            }
+            if (ch == -1)
+                continue;
+            if (filter)
+            {
+                // in filter mode the input keys edit the path filter.
+                // appending a character only narrows the current matches.
+                if (ch == '\n' || ch == '\r' || ch == 27)
+                {
+                    filter = false;
+                    help   = false;
+                    continue;
+                }
+                if (ch == 127 || ch == '\b')
+                {
+                    if (filter_text.empty())
+                        continue;
+                    filter_text.resize(filter_text.size() - 1);
+                    if (filter_text.empty())
+                        list.unfilter();
+                    else
+                        list.filter(std::bind(path_contains, std::placeholders::_1, filter_text));
+                }
+                else if (ch >= 0x20 && ch < 0x7f)
+                {
+                    filter_text += (char)ch;
+                    list.narrow(std::bind(path_contains, std::placeholders::_1, filter_text));
+                }
+                else if (ch == TERM_PASTE)
+                {
+                    // narrow once for the whole pasted text.
+                    const std::string& text = term_paste_text();
+                    for (size_t i=0; i<text.size(); ++i)
+                    {
+                        if (text[i] >= 0x20 && text[i] < 0x7f)
+                            filter_text += text[i];
+                    }
+                    list.narrow(std::bind(path_contains, std::placeholders::_1, filter_text));
+                }
+                else continue;
+
+                list.reindex();
+                list.selpos(0);
+                wnd.update(&list);
+                text4.settext("Filter: " + filter_text);
+                wnd.update(&text4);
+                continue;
+            }
             int vk = map_input(ch);
             if (!help)
             {
@@ -541,42 +628,64 @@ int main(int argc, const char* argv[])
                     loop = false;
                     break;
                 case VK_SORT_BY_NAME:
-                    sort(files.begin(), files.end(), sort_by_name);
-                    list.selpos(0);
-                    wnd.update(&list);
-                    break;
                 case VK_SORT_BY_SIZE:
-                    sort(files.begin(), files.end(), sort_by_size);
-                    list.selpos(0);
-                    wnd.update(&list);
-                    break;
                 case VK_SORT_BY_CODE:
-                    sort(files.begin(), files.end(), sort_by_code);
-                    list.selpos(0);
-                    wnd.update(&list);
-                    break;
                 case VK_SORT_BY_BLANK:
-                    sort(files.begin(), files.end(), sort_by_blank);
-                    list.selpos(0);
-                    wnd.update(&list);
+                    {
+                        // the sort keys are in the same order as the columns.
+                        // names sort ascending and numbers descending by default
+                        // and sorting the same column again flips the direction.
+                        const int col = vk - VK_SORT_BY_NAME;
+                        bool ascending = col == 0;
+                        if (col == sort_column)
+                            ascending = !sort_ascending;
+                        list.sort_async(col, ascending);
+                        if (list.sort_pending())
+                        {
+                            text4.settext("Sorting...");
+                            wnd.update(&text4);
+                            help = false;
+                        }
+                        else
+                        {
+                            list.refilter();
+                            list.reindex();
+                            list.selpos(0);
+                            wnd.update(&list);
+                        }
+                        sort_column = col;
+                        sort_ascending = ascending;
+                    }
+                    break;
+                case VK_FILTER:
+                    filter = true;
+                    text4.settext("Filter: " + filter_text);
+                    wnd.update(&text4);
                     break;
                 case VK_EXPORT:
-                    switch (export_html(files, "export.html", stat, include, exclude))
                     {
-                        case EXPORT_SUCCESS:
-                            text4.settext("Export done. Wrote export.html");
-                            wnd.update(&text4);
-                            break;
-                        case EXPORT_FAIL:
-                        case EXPORT_FAIL_FILE_EXISTS:
-                            text4.settext("Export failed.");
-                            wnd.update(&text4);
-                            break;
+                        // export in the displayed order
+                        vector<file*> sorted(files.size());
+                        for (size_t i=0; i<files.size(); ++i)
+                            sorted[i] = files[list.sorted_row(i)];
+                        switch (export_html(sorted, "export.html", stat, include, exclude))
+                        {
+                            case EXPORT_SUCCESS:
+                                text4.settext("Export done. Wrote export.html");
+                                wnd.update(&text4);
+                                break;
+                            case EXPORT_FAIL:
+                            case EXPORT_FAIL_FILE_EXISTS:
+                                text4.settext("Export failed.");
+                                wnd.update(&text4);
+                                break;
+                        }
                     }
                     help = false;
                     break;
                 default:
-                    wnd.keydown(0, vk);
+                    // unmapped keys go to the type-ahead search of the list.
+                    wnd.keydown(ch, vk);
                     break;
             }
         }
@@ -26,9 +26,22 @@
 
 #include <boost/test/minimal.hpp>
 #include <cli/widgets.h>
+#include <cli/instrument.h>
+#include <cli/session.h>
+#include <cli/framedump.h>
+#include <cli/color.h>
+#include <cli/fuzzy.h>
+#include <cli/varint.h>
 #include <iostream>
 #include <string>
+#include <sstream>
+#include <fstream>
+#include <cstring>
+#include <stdexcept>
 #include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
 
 struct conv
 {
@@ -53,6 +66,35 @@ struct stringdb
     int rowcount;
 };
 
+// count all allocations in the tests.
+CLI_INSTRUMENT_ALLOCATIONS()
+
+struct nameconv
+{
+    nameconv(const std::string& s) : str_(s) {}
+    nameconv(const std::string& s, int) : str_(s) {}
+    const char* str() const { return str_.c_str(); }
+    size_t len() const { return str_.size(); }
+    const std::string& str_;
+};
+
+struct namedb
+{
+    typedef std::string value;
+    typedef nameconv    converter;
+
+    void fetch(value& v, int index) const
+    {
+        v = names[index];
+    }
+    int size() const
+    {
+        return static_cast<int>(names.size());
+    }
+
+    std::vector<std::string> names;
+};
+
 /*
  * Synopsis: Verify that widgets report their invalid rectagnle correctly.
  *
@@ -283,7 +325,7 @@ void test1()
     cli::buffer fb;
     fb.resize(50, 100);
 
-    cli::cell c = {'X', cli::ATTRIB_NONE, cli::COLOR_NONE};
+    cli::cell c = {'X', cli::ATTRIB_NONE, cli::COLOR_NONE, 0, 0};
     fb.fill(c);
     {
 
@@ -655,8 +697,8 @@ void test6()
     cli::buffer fb;
     fb.resize(1, 50);
     
-    cli::cell blank = {0,   cli::ATTRIB_NONE, cli::COLOR_NONE};
-    cli::cell fill  = {'x', 100, 150};
+    cli::cell blank = {0,   cli::ATTRIB_NONE, cli::COLOR_NONE, 0, 0};
+    cli::cell fill  = {'x', 100, 150, 0, 0};
 
     fb.fill(blank);
 
@@ -766,6 +808,2293 @@ void test6()
     }
 }
 
+/*
+ * Synopsis: Verify that multi range selection works.
+ *
+ * Expected: Any number of disjoint row ranges can be marked, unmarked,
+ *           inverted and iterated. Row counts stay correct.
+ */
+void test7()
+{
+    cli::row_set set;
+    BOOST_REQUIRE(set.empty());
+
+    set.add(10, 20);
+    set.add(30, 40);
+    BOOST_REQUIRE(set.count() == 20);
+    BOOST_REQUIRE(set.intervals().size() == 2);
+    BOOST_REQUIRE(set.contains(10));
+    BOOST_REQUIRE(set.contains(19));
+    BOOST_REQUIRE(set.contains(20) == false);
+    BOOST_REQUIRE(set.contains(9) == false);
+
+    // adjacent and overlapping ranges are merged
+    set.add(20, 30);
+    BOOST_REQUIRE(set.count() == 30);
+    BOOST_REQUIRE(set.intervals().size() == 1);
+
+    // removing from the middle splits the range
+    set.remove(15, 25);
+    BOOST_REQUIRE(set.count() == 20);
+    BOOST_REQUIRE(set.intervals().size() == 2);
+    BOOST_REQUIRE(set.contains(14));
+    BOOST_REQUIRE(set.contains(15) == false);
+    BOOST_REQUIRE(set.contains(25));
+
+    set.toggle(20);
+    BOOST_REQUIRE(set.contains(20));
+    BOOST_REQUIRE(set.count() == 21);
+    set.toggle(20);
+    BOOST_REQUIRE(set.contains(20) == false);
+    BOOST_REQUIRE(set.count() == 20);
+
+    // invert within [0, 50)
+    set.invert(50);
+    BOOST_REQUIRE(set.count() == 30);
+    BOOST_REQUIRE(set.contains(0));
+    BOOST_REQUIRE(set.contains(10) == false);
+    BOOST_REQUIRE(set.contains(15));
+    BOOST_REQUIRE(set.contains(49));
+
+    int count = 0;
+    int last  = -1;
+    for (cli::row_set::const_iterator it = set.begin(); it != set.end(); ++it)
+    {
+        BOOST_REQUIRE(*it > last);
+        BOOST_REQUIRE(set.contains(*it));
+        last = *it;
+        ++count;
+    }
+    BOOST_REQUIRE(count == set.count());
+
+    // large ranges cost the same as small ones
+    set.clear();
+    set.add(0, 1000000);
+    set.remove(500000, 500001);
+    BOOST_REQUIRE(set.count() == 999999);
+    BOOST_REQUIRE(set.intervals().size() == 2);
+
+    test_selection<cli::multi_range_selection> sel;
+    BOOST_REQUIRE(sel.selcount() == 0);
+
+    // rubberband rows 2-4
+    sel.test_keydown(cli::VK_MOVE_DOWN, 10, 20);
+    sel.test_keydown(cli::VK_MOVE_DOWN, 10, 20);
+    sel.test_keydown(cli::VK_SET_MARK, 10, 20);
+    sel.test_keydown(cli::VK_MOVE_DOWN, 10, 20);
+    sel.test_keydown(cli::VK_MOVE_DOWN, 10, 20);
+    BOOST_REQUIRE(sel.test_is_selected(3));
+    BOOST_REQUIRE(sel.selcount() == 0);
+    sel.test_keydown(cli::VK_SET_MARK, 10, 20);
+    BOOST_REQUIRE(sel.selcount() == 3);
+
+    // toggle a single row further down
+    sel.test_keydown(cli::VK_MOVE_END, 10, 20);
+    sel.test_keydown(cli::VK_SET_MARK, 10, 20);
+    sel.test_keydown(cli::VK_SET_MARK, 10, 20);
+    BOOST_REQUIRE(sel.selcount() == 4);
+    BOOST_REQUIRE(sel.test_is_selected(2));
+    BOOST_REQUIRE(sel.test_is_selected(4));
+    BOOST_REQUIRE(sel.test_is_selected(19));
+    BOOST_REQUIRE(sel.test_is_selected(10) == false);
+
+    sel.selinvert(20);
+    BOOST_REQUIRE(sel.selcount() == 16);
+    sel.selclear();
+    BOOST_REQUIRE(sel.selcount() == 0);
+}
+
+/*
+ * Synopsis: Verify that type-ahead search moves the selection.
+ *
+ * Expected: Typed characters jump to the next matching row, non matching
+ *           characters are ignored, repeating a character cycles through
+ *           the matches and erase widens the search again from the
+ *           current row, also when there are more rows than fit in
+ *           one block of the row index.
+ */
+void test8()
+{
+    cli::basic_list<namedb,
+        cli::default_single_selection,
+        cli::default_ticker,
+        cli::default_pager,
+        cli::prefix_finder> l;
+    l.names.push_back("zeta.cpp");
+    l.names.push_back("Alpha.h");
+    l.names.push_back("beta.cpp");
+    l.names.push_back("alpine.txt");
+    l.names.push_back("bravo.h");
+    l.height(2);
+    l.width(20);
+
+    BOOST_REQUIRE(l.selpos() == 0);
+    BOOST_REQUIRE(l.keydown('b', -1));
+    BOOST_REQUIRE(l.selpos() == 2);
+    BOOST_REQUIRE(l.keydown('r', -1));
+    BOOST_REQUIRE(l.selpos() == 4);
+    BOOST_REQUIRE(l.search_text() == "br");
+
+    // no match, selection is kept
+    BOOST_REQUIRE(l.keydown('x', -1) == false);
+    BOOST_REQUIRE(l.selpos() == 4);
+    BOOST_REQUIRE(l.search_text() == "br");
+
+    // the current row still matches the shorter prefix.
+    BOOST_REQUIRE(l.keydown(0, cli::VK_ERASE));
+    BOOST_REQUIRE(l.selpos() == 4);
+
+    // moving the selection ends the search
+    BOOST_REQUIRE(l.keydown(0, cli::VK_MOVE_HOME));
+    BOOST_REQUIRE(l.search_text().empty());
+
+    // case insensitive
+    BOOST_REQUIRE(l.keydown('A', -1));
+    BOOST_REQUIRE(l.selpos() == 1);
+    BOOST_REQUIRE(l.keydown('l', -1));
+    BOOST_REQUIRE(l.keydown('p', -1));
+    BOOST_REQUIRE(l.keydown('i', -1));
+    BOOST_REQUIRE(l.selpos() == 3);
+
+    // the index follows the data when the row count changes
+    l.keydown(0, cli::VK_MOVE_HOME);
+    l.names.push_back("delta.cpp");
+    BOOST_REQUIRE(l.keydown('d', -1));
+    BOOST_REQUIRE(l.selpos() == 5);
+
+    // the search starts from the current row and
+    // repeating the character cycles through the matches.
+    l.keydown(0, cli::VK_MOVE_HOME);
+    l.selpos(3);
+    BOOST_REQUIRE(l.keydown('b', -1));
+    BOOST_REQUIRE(l.selpos() == 4);
+    BOOST_REQUIRE(l.keydown('b', -1));
+    BOOST_REQUIRE(l.selpos() == 2);
+    BOOST_REQUIRE(l.keydown('B', -1));
+    BOOST_REQUIRE(l.selpos() == 4);
+    BOOST_REQUIRE(l.search_text() == "b");
+
+    // many rows interleave the matches across the blocks of the index.
+    cli::basic_list<namedb,
+        cli::default_single_selection,
+        cli::default_ticker,
+        cli::default_pager,
+        cli::prefix_finder> big;
+    for (int i=0; i<5000; ++i)
+        big.names.push_back(std::string(i % 3 ? "a" : "b") + std::to_string(5000 - i));
+    big.height(2);
+    big.width(20);
+    big.selpos(2500);
+    BOOST_REQUIRE(big.keydown('b', -1));
+    BOOST_REQUIRE(big.selpos() == 2502);
+    BOOST_REQUIRE(big.keydown('b', -1));
+    BOOST_REQUIRE(big.selpos() == 2505);
+    big.keydown(0, cli::VK_MOVE_END);
+    BOOST_REQUIRE(big.selpos() == 4999);
+    BOOST_REQUIRE(big.keydown('b', -1));
+    BOOST_REQUIRE(big.selpos() == 0);
+    BOOST_REQUIRE(big.keydown('4', -1));
+    BOOST_REQUIRE(big.selpos() == 3);
+
+    cli::basic_table<namedb,
+        cli::default_single_selection,
+        cli::default_ticker,
+        cli::default_pager,
+        cli::prefix_finder> t;
+    t.names = l.names;
+    t.addcol(10);
+    t.height(2);
+    t.width(20);
+    BOOST_REQUIRE(t.keydown('z', -1));
+    BOOST_REQUIRE(t.selpos() == 0);
+    BOOST_REQUIRE(t.keydown('e', -1));
+    BOOST_REQUIRE(t.keydown(0, cli::VK_MOVE_DOWN));
+    BOOST_REQUIRE(t.selpos() == 1);
+}
+
+bool name_contains(const std::string& name, const std::string& str)
+{
+    return name.find(str) != std::string::npos;
+}
+
+/*
+ * Synopsis: Verify that the filtered view adaptor works.
+ *
+ * Expected: Only the rows matching the filter are exposed and narrowing
+ *           the filter keeps the row mapping correct.
+ */
+void test9()
+{
+    cli::basic_list<cli::filtered_view<namedb> > l;
+    l.names.push_back("src/main.cpp");
+    l.names.push_back("src/main.h");
+    l.names.push_back("doc/readme.txt");
+    l.names.push_back("src/menu.cpp");
+    l.names.push_back("test/main_test.cpp");
+    l.height(10);
+    l.width(20);
+
+    BOOST_REQUIRE(l.is_filtered() == false);
+    BOOST_REQUIRE(l.can_focus());
+
+    l.filter(std::bind(name_contains, std::placeholders::_1, std::string("m")));
+    BOOST_REQUIRE(l.is_filtered());
+    BOOST_REQUIRE(l.source_row(0) == 0);
+    BOOST_REQUIRE(l.source_row(1) == 1);
+    BOOST_REQUIRE(l.source_row(2) == 2);
+    BOOST_REQUIRE(l.source_row(3) == 3);
+    BOOST_REQUIRE(l.source_row(4) == 4);
+
+    l.narrow(std::bind(name_contains, std::placeholders::_1, std::string("ma")));
+    BOOST_REQUIRE(l.source_row(0) == 0);
+    BOOST_REQUIRE(l.source_row(1) == 1);
+    BOOST_REQUIRE(l.source_row(2) == 4);
+
+    l.narrow(std::bind(name_contains, std::placeholders::_1, std::string("main.")));
+    BOOST_REQUIRE(l.source_row(0) == 0);
+    BOOST_REQUIRE(l.source_row(1) == 1);
+
+    // the widget only sees the matching rows
+    l.keydown(0, cli::VK_MOVE_END);
+    BOOST_REQUIRE(l.selpos() == 1);
+
+    l.narrow(std::bind(name_contains, std::placeholders::_1, std::string("nomatch")));
+    BOOST_REQUIRE(l.can_focus() == false);
+
+    l.filter(std::bind(name_contains, std::placeholders::_1, std::string("txt")));
+    BOOST_REQUIRE(l.source_row(0) == 2);
+
+    l.unfilter();
+    BOOST_REQUIRE(l.is_filtered() == false);
+    BOOST_REQUIRE(l.source_row(3) == 3);
+}
+
+struct record
+{
+    std::string name;
+    int size;
+};
+
+struct recordconv
+{
+    recordconv(const record* r, int col) : str_(col == 0 ? r->name : std::string()) {}
+    const char* str() const { return str_.c_str(); }
+    size_t len() const { return str_.size(); }
+    std::string str_;
+};
+
+struct recorddb
+{
+    typedef const record* value;
+    typedef recordconv    converter;
+
+    void fetch(value& v, int index) const
+    {
+        v = &records[index];
+    }
+    int size() const
+    {
+        return static_cast<int>(records.size());
+    }
+    std::vector<record> records;
+};
+
+long long record_size(const record* r)
+{
+    return r->size;
+}
+
+template<typename Database>
+struct test_view : public Database
+{
+    const record* test_fetch(int row)
+    {
+        typename Database::value val;
+        Database::fetch(val, row);
+        return val;
+    }
+};
+
+/*
+ * Synopsis: Verify that the sorted view adaptor works.
+ *
+ * Expected: Rows are presented in sorted order. Sorts are stable so
+ *           that consecutive sorts combine into a multi column sort, also
+ *           when the direction of the last sort is flipped.
+ */
+void test10()
+{
+    test_view<cli::sorted_view<recorddb> > view;
+    const char* names[] = {"delta", "alpha", "charlie", "bravo", "alphabet", "echo"};
+    const int   sizes[] = {3, 1, 3, 2, 1, -5};
+    for (int i=0; i<6; ++i)
+    {
+        record r = {names[i], sizes[i]};
+        view.records.push_back(r);
+    }
+    view.intkey(1, record_size);
+
+    BOOST_REQUIRE(view.sorted_row(0) == 0);
+
+    // strings sorted by the converter output
+    view.sort(0, true);
+    BOOST_REQUIRE(view.test_fetch(0)->name == "alpha");
+    BOOST_REQUIRE(view.test_fetch(1)->name == "alphabet");
+    BOOST_REQUIRE(view.test_fetch(2)->name == "bravo");
+    BOOST_REQUIRE(view.test_fetch(5)->name == "echo");
+
+    // stable integer sort keeps the names sorted within equal sizes
+    view.sort(1, false);
+    BOOST_REQUIRE(view.test_fetch(0)->name == "charlie");
+    BOOST_REQUIRE(view.test_fetch(1)->name == "delta");
+    BOOST_REQUIRE(view.test_fetch(2)->name == "bravo");
+    BOOST_REQUIRE(view.test_fetch(3)->name == "alpha");
+    BOOST_REQUIRE(view.test_fetch(4)->name == "alphabet");
+    BOOST_REQUIRE(view.test_fetch(5)->name == "echo");
+
+    // flipping the direction keeps the equal rows in the same order
+    view.sort(1, true);
+    BOOST_REQUIRE(view.test_fetch(0)->name == "echo");
+    BOOST_REQUIRE(view.test_fetch(1)->name == "alpha");
+    BOOST_REQUIRE(view.test_fetch(2)->name == "alphabet");
+    BOOST_REQUIRE(view.test_fetch(3)->name == "bravo");
+    BOOST_REQUIRE(view.test_fetch(4)->name == "charlie");
+    BOOST_REQUIRE(view.test_fetch(5)->name == "delta");
+
+    view.sort(0, false);
+    BOOST_REQUIRE(view.test_fetch(0)->name == "echo");
+    BOOST_REQUIRE(view.test_fetch(5)->name == "alpha");
+
+    // multi column sort with the primary column first
+    std::vector<std::pair<int, bool> > cols;
+    cols.push_back(std::make_pair(1, true));
+    cols.push_back(std::make_pair(0, false));
+    view.unsort();
+    view.sort(cols);
+    BOOST_REQUIRE(view.test_fetch(0)->name == "echo");
+    BOOST_REQUIRE(view.test_fetch(1)->name == "alphabet");
+    BOOST_REQUIRE(view.test_fetch(2)->name == "alpha");
+    BOOST_REQUIRE(view.test_fetch(3)->name == "bravo");
+    BOOST_REQUIRE(view.test_fetch(4)->name == "delta");
+    BOOST_REQUIRE(view.test_fetch(5)->name == "charlie");
+
+    // data changes are picked up by resort
+    view.records[0].size = -10;
+    view.resort();
+    BOOST_REQUIRE(view.test_fetch(0)->name == "delta");
+
+    view.unsort();
+    BOOST_REQUIRE(view.test_fetch(0)->name == "delta");
+    BOOST_REQUIRE(view.test_fetch(1)->name == "alpha");
+
+    // larger data set against std::stable_sort
+    test_view<cli::sorted_view<recorddb> > big;
+    for (int i=0; i<5000; ++i)
+    {
+        record r = {std::string(1, 'a' + (i * 7) % 26), (i * 7919) % 1000 - 500};
+        big.records.push_back(r);
+    }
+    big.intkey(1, record_size);
+    big.sort(1, true);
+    for (int i=1; i<5000; ++i)
+        BOOST_REQUIRE(big.test_fetch(i-1)->size <= big.test_fetch(i)->size);
+    big.sort(1, false);
+    for (int i=1; i<5000; ++i)
+        BOOST_REQUIRE(big.test_fetch(i-1)->size >= big.test_fetch(i)->size);
+}
+
+/*
+ * Synopsis: Verify the parallel sort and the background sort of the sorted view.
+ *
+ * Expected: The parallel sort gives the same order as std::stable_sort.
+ *           The view keeps the previous order until the background sort
+ *           is picked up and then matches the synchronous sort.
+ */
+void test11()
+{
+    const int count = 100000;
+    std::vector<cli::sort_key> keys(count);
+    for (int i=0; i<count; ++i)
+    {
+        keys[i].key = (i * 7919ull) % 1000;
+        keys[i].row = i;
+    }
+    std::vector<cli::sort_key> expected(keys);
+    std::stable_sort(expected.begin(), expected.end(), cli::sort_key_less());
+
+    std::vector<cli::sort_key> tmp;
+    for (unsigned threads=1; threads<=5; ++threads)
+    {
+        std::vector<cli::sort_key> sorted(keys);
+        BOOST_REQUIRE(cli::sort_parallel(sorted, tmp, cli::sort_chunk_radix(), cli::sort_key_less(), threads));
+        for (int i=0; i<count; ++i)
+        {
+            BOOST_REQUIRE(sorted[i].key == expected[i].key);
+            BOOST_REQUIRE(sorted[i].row == expected[i].row);
+        }
+    }
+
+    test_view<cli::sorted_view<recorddb> > sync;
+    test_view<cli::sorted_view<recorddb> > async;
+    for (int i=0; i<count; ++i)
+    {
+        record r = {std::string(1, 'a' + (i * 31) % 26), (i * 7919) % 1000 - 500};
+        sync.records.push_back(r);
+        async.records.push_back(r);
+    }
+    sync.intkey(1, record_size);
+    async.intkey(1, record_size);
+
+    BOOST_REQUIRE(!async.sort_poll());
+    BOOST_REQUIRE(!async.sort_wait());
+
+    sync.sort(0, true);
+    sync.sort(1, false);
+    async.sort_async(0, true);
+    BOOST_REQUIRE(async.sort_pending());
+    BOOST_REQUIRE(async.sorted_row(0) == 0);
+    BOOST_REQUIRE(async.sort_wait());
+    BOOST_REQUIRE(!async.sort_pending());
+    async.sort_async(1, false);
+    while (!async.sort_poll())
+        ;
+    for (int i=0; i<count; ++i)
+        BOOST_REQUIRE(sync.sorted_row(i) == async.sorted_row(i));
+
+    // flipping the direction of the last column needs no background work
+    sync.sort(1, true);
+    async.sort_async(1, true);
+    BOOST_REQUIRE(!async.sort_pending());
+    for (int i=0; i<count; ++i)
+        BOOST_REQUIRE(sync.sorted_row(i) == async.sorted_row(i));
+
+    // cancelling keeps the current order
+    async.sort_async(0, false);
+    async.sort_cancel();
+    BOOST_REQUIRE(!async.sort_pending());
+    for (int i=0; i<count; ++i)
+        BOOST_REQUIRE(sync.sorted_row(i) == async.sorted_row(i));
+
+    // cancelling doesn't wait for the sort threads and 
+    // a new sort can start while they wind down.
+    async.sort_async(0, false);
+    async.sort_cancel();
+    async.sort_async(0, false);
+    BOOST_REQUIRE(async.sort_wait());
+    sync.sort(0, false);
+    for (int i=0; i<count; ++i)
+        BOOST_REQUIRE(sync.sorted_row(i) == async.sorted_row(i));
+}
+
+struct test_ticker : public cli::right_to_left_ticker
+{
+    using cli::right_to_left_ticker::set;
+    using cli::right_to_left_ticker::scroll;
+    using cli::right_to_left_ticker::is_set;
+    using cli::right_to_left_ticker::reset;
+    using cli::right_to_left_ticker::is_idle;
+    using cli::right_to_left_ticker::next_frame;
+};
+
+std::string row_text(const cli::buffer& fb, int row, int len)
+{
+    std::string str;
+    for (int i=0; i<len; ++i)
+        str.push_back(static_cast<char>(fb[row][i].value));
+    return str;
+}
+
+/*
+ * Synopsis: Verify that the right to left ticker scrolls correctly.
+ *
+ * Expected: The line is padded to the ticker width and each frame shows
+ *           the line rotated one more cell to the left, wrapping around.
+ */
+void test12()
+{
+    cli::buffer fb;
+    fb.resize(2, 6);
+
+    test_ticker t;
+    BOOST_REQUIRE(!t.is_set());
+    t.set("abc", 5);
+    BOOST_REQUIRE(t.is_set());
+
+    t.scroll(fb, 1, 1);
+    BOOST_REQUIRE(row_text(fb, 1, 6) == std::string(1, 0) + "abc  ");
+    BOOST_REQUIRE(fb[1][1].color == cli::COLOR_SELECTION);
+    t.scroll(fb, 1, 1);
+    BOOST_REQUIRE(row_text(fb, 1, 6).substr(1) == "bc  a");
+    for (int i=0; i<3; ++i)
+        t.scroll(fb, 1, 1);
+    BOOST_REQUIRE(row_text(fb, 1, 6).substr(1) == " abc ");
+    t.scroll(fb, 1, 1);
+    BOOST_REQUIRE(row_text(fb, 1, 6).substr(1) == "abc  ");
+
+    // longer than the width
+    t.reset();
+    BOOST_REQUIRE(!t.is_set());
+    t.set("abcdefgh", 4);
+    t.scroll(fb, 0, 0);
+    BOOST_REQUIRE(row_text(fb, 0, 4) == "abcd");
+    for (int i=0; i<6; ++i)
+        t.scroll(fb, 0, 0);
+    BOOST_REQUIRE(row_text(fb, 0, 4) == "ghab");
+
+    // clipped at the buffer edge
+    t.scroll(fb, 4, 0);
+    BOOST_REQUIRE(row_text(fb, 0, 6) == "ghabha");
+}
+
+struct frame_widget : public cli::widget
+{
+    frame_widget(int frame) : frame(frame), frames(0), elapsed(0) {}
+
+    int height() const { return 1; }
+    int width() const { return 1; }
+    cli::rect draw(cli::buffer&)
+    {
+        cli::rect rc = {};
+        return rc;
+    }
+    cli::rect animate(cli::buffer&, int ms)
+    {
+        ++frames;
+        elapsed = ms;
+        cli::rect rc = {};
+        return rc;
+    }
+    int next_frame() const
+    {
+        return frame;
+    }
+    int frame;
+    int frames;
+    int elapsed;
+};
+
+/*
+ * Synopsis: Verify the window animation scheduling.
+ *
+ * Expected: Widgets are only animated when their next frame is due and
+ *           get all the time elapsed since their last frame. The window
+ *           reports the earliest deadline.
+ */
+void test13()
+{
+    cli::buffer fb;
+    fb.resize(5, 5);
+
+    frame_widget fast(100);
+    frame_widget slow(250);
+    frame_widget idle(-1);
+
+    cli::window wnd;
+    BOOST_REQUIRE(wnd.next_frame() == -1);
+    wnd.add(&fast);
+    wnd.add(&slow);
+    wnd.add(&idle);
+    BOOST_REQUIRE(wnd.next_frame() == 100);
+
+    wnd.animate(fb, 40);
+    BOOST_REQUIRE(fast.frames == 0);
+    BOOST_REQUIRE(wnd.next_frame() == 60);
+
+    wnd.animate(fb, 60);
+    BOOST_REQUIRE(fast.frames == 1);
+    BOOST_REQUIRE(fast.elapsed == 100);
+    BOOST_REQUIRE(slow.frames == 0);
+    BOOST_REQUIRE(wnd.next_frame() == 100);
+
+    wnd.animate(fb, 160);
+    BOOST_REQUIRE(fast.frames == 2);
+    BOOST_REQUIRE(fast.elapsed == 160);
+    BOOST_REQUIRE(slow.frames == 1);
+    BOOST_REQUIRE(slow.elapsed == 260);
+    BOOST_REQUIRE(idle.frames == 0);
+
+    // a widget that stops animating drops out of the schedule
+    fast.frame = -1;
+    BOOST_REQUIRE(wnd.next_frame() == 250);
+    wnd.animate(fb, 300);
+    BOOST_REQUIRE(fast.frames == 2);
+    BOOST_REQUIRE(slow.frames == 2);
+    BOOST_REQUIRE(wnd.next_frame() == 250);
+
+    // redrawing a widget restarts its wait
+    wnd.animate(fb, 200);
+    wnd.update(&slow);
+    wnd.draw(fb);
+    BOOST_REQUIRE(wnd.next_frame() == 250);
+
+    // the ticker waits for the idle treshold and then runs at the frame interval
+    test_ticker t;
+    t.set_animation_treshold(1000);
+    t.set_frame_interval(50);
+    t.set("abc", 3);
+    BOOST_REQUIRE(t.next_frame() == 1000);
+    BOOST_REQUIRE(t.is_idle(400));
+    BOOST_REQUIRE(t.next_frame() == 600);
+    BOOST_REQUIRE(!t.is_idle(600));
+    BOOST_REQUIRE(t.next_frame() == 50);
+    t.enable_scrolling(false);
+    BOOST_REQUIRE(t.next_frame() == -1);
+}
+
+template<typename Window>
+void count_draws(Window*, int* count)
+{
+    ++*count;
+}
+
+/*
+ * Synopsis: Verify that the static window draws and dispatches like the window.
+ *
+ * Expected: Only invalid widgets are drawn, the focused widget is drawn last
+ *           and receives the keys, focus moves between focusable widgets and 
+ *           animations are scheduled.
+ */
+void test14()
+{
+    cli::buffer fb;
+    fb.resize(5, 20);
+
+    cli::text text;
+    text.position(0, 0);
+    text.settext("hello");
+
+    cli::basic_list<namedb> list;
+    list.names.push_back("foo");
+    list.names.push_back("bar");
+    list.position(0, 1);
+    list.width(10);
+    list.height(2);
+
+    cli::checkbox check;
+    check.position(0, 4);
+
+    frame_widget frames(100);
+
+    typedef cli::static_window<cli::text, cli::basic_list<namedb>, cli::checkbox, frame_widget> static_window;
+
+    int draws = 0;
+    static_window wnd;
+    wnd.evtdraw = std::bind(count_draws<static_window>, std::placeholders::_1, &draws);
+    wnd.add(&text);
+    wnd.add(&list);
+    wnd.add(&check);
+    wnd.add(&frames);
+    BOOST_REQUIRE(wnd.has_widget(&list));
+    BOOST_REQUIRE(!wnd.focused());
+
+    wnd.show();
+    BOOST_REQUIRE(wnd.focused());
+    BOOST_REQUIRE(boost::get<cli::basic_list<namedb>*>(*wnd.focused()) == &list);
+    wnd.invalidate();
+    BOOST_REQUIRE(draws == 1);
+
+    cli::rect rc = wnd.draw(fb);
+    BOOST_REQUIRE(rc.top == 0 && rc.left == 0);
+    BOOST_REQUIRE(rc.bottom == 5);
+    BOOST_REQUIRE(fb[0][0].value == 'h');
+    BOOST_REQUIRE(fb[1][0].value == 'f');
+    BOOST_REQUIRE(wnd.is_valid());
+
+    // nothing is invalid so nothing is drawn
+    rc = wnd.draw(fb);
+    BOOST_REQUIRE(cli::rect_is_empty(rc));
+
+    text.settext("world");
+    wnd.update(&text);
+    rc = wnd.draw(fb);
+    BOOST_REQUIRE(rc.top == 0 && rc.bottom == 1);
+    BOOST_REQUIRE(fb[0][0].value == 'w');
+
+    BOOST_REQUIRE(wnd.keydown(0, cli::VK_MOVE_DOWN));
+    BOOST_REQUIRE(list.selpos() == 1);
+
+    BOOST_REQUIRE(wnd.keydown(0, cli::VK_FOCUS_NEXT));
+    BOOST_REQUIRE(boost::get<cli::checkbox*>(*wnd.focused()) == &check);
+    BOOST_REQUIRE(wnd.keydown(0, cli::VK_FOCUS_NEXT));
+    BOOST_REQUIRE(boost::get<cli::basic_list<namedb>*>(*wnd.focused()) == &list);
+    BOOST_REQUIRE(wnd.keydown(0, cli::VK_FOCUS_PREV));
+    BOOST_REQUIRE(boost::get<cli::checkbox*>(*wnd.focused()) == &check);
+    wnd.draw(fb);
+
+    BOOST_REQUIRE(wnd.next_frame() == 100);
+    wnd.animate(fb, 100);
+    BOOST_REQUIRE(frames.frames == 1);
+    BOOST_REQUIRE(frames.elapsed == 100);
+
+    wnd.rem(&text);
+    BOOST_REQUIRE(!wnd.has_widget(&text));
+    BOOST_REQUIRE(boost::get<cli::checkbox*>(*wnd.focused()) == &check);
+}
+
+/*
+ * Synopsis: Verify that the allocation hook counts allocations and that
+ *           steady state frames don't allocate.
+ *
+ * Expected: Allocations are counted once the hook is installed. After
+ *           the first frame drawing, animating and moving around in a 
+ *           list doesn't allocate anything.
+ */
+void test15()
+{
+    BOOST_REQUIRE(cli::alloc_instrumented());
+    const cli::alloc_stats before = cli::alloc_counters();
+    delete new int(0);
+    const cli::alloc_stats diff = cli::alloc_counters() - before;
+    BOOST_REQUIRE(diff.allocs == 1);
+    BOOST_REQUIRE(diff.frees == 1);
+    BOOST_REQUIRE(diff.bytes == sizeof(int));
+
+    cli::buffer fb;
+    fb.resize(10, 40);
+
+    cli::text text;
+    text.settext("hello");
+
+    cli::checkbox check;
+    check.text("check");
+    check.position(0, 1);
+
+    cli::basic_list<namedb, cli::default_single_selection, cli::right_to_left_ticker> list;
+    // short names so that fetching a row by value doesn't allocate.
+    for (int i=0; i<20; ++i)
+        list.names.push_back("list item");
+    list.position(0, 2);
+    list.width(10);
+    list.height(8);
+    list.set_animation_treshold(0);
+
+    cli::window wnd;
+    wnd.add(&text);
+    wnd.add(&check);
+    wnd.add(&list);
+    wnd.show();
+    wnd.focus(&list);
+
+    // first frame may grow some buffers.
+    wnd.invalidate();
+    wnd.draw(fb);
+    wnd.animate(fb, 1000);
+
+    for (int i=0; i<10; ++i)
+    {
+        wnd.invalidate();
+        wnd.draw(fb);
+        BOOST_REQUIRE(wnd.allocations().draw.allocs == 0);
+
+        wnd.animate(fb, 1000);
+        BOOST_REQUIRE(wnd.allocations().animate.allocs == 0);
+    }
+    wnd.keydown(0, cli::VK_MOVE_DOWN);
+    BOOST_REQUIRE(wnd.allocations().keydown.allocs == 0);
+    wnd.keydown(0, cli::VK_MOVE_UP);
+    BOOST_REQUIRE(wnd.allocations().keydown.allocs == 0);
+}
+
+/*
+ * Synopsis: Verify the window frame statistics.
+ *
+ * Expected: Drawn and skipped widgets, the dirty area and the output bytes
+ *           are recorded per frame and the times are collected into the 
+ *           rolling histograms.
+ */
+void test16()
+{
+    cli::rolling_histogram hist(4);
+    BOOST_REQUIRE(hist.count() == 0);
+    BOOST_REQUIRE(hist.percentile(0.5) == 0);
+    for (int i=1; i<=6; ++i)
+        hist.add(i * 10);
+    BOOST_REQUIRE(hist.count() == 4);
+    BOOST_REQUIRE(hist.sample(0) == 30);
+    BOOST_REQUIRE(hist.sample(3) == 60);
+    BOOST_REQUIRE(hist.min() == 30);
+    BOOST_REQUIRE(hist.max() == 60);
+    BOOST_REQUIRE(hist.mean() == 45.0);
+    BOOST_REQUIRE(hist.percentile(0.0) == 30);
+    BOOST_REQUIRE(hist.percentile(1.0) == 60);
+    std::vector<int> buckets(3);
+    hist.buckets(20, buckets);
+    BOOST_REQUIRE(buckets[0] == 0);
+    BOOST_REQUIRE(buckets[1] == 1);
+    BOOST_REQUIRE(buckets[2] == 3);
+
+    cli::buffer fb;
+    fb.resize(5, 20);
+
+    cli::text text1;
+    text1.settext("hello");
+    cli::text text2;
+    text2.position(0, 1);
+    text2.settext("world");
+
+    cli::window wnd;
+    wnd.add(&text1);
+    wnd.add(&text2);
+    wnd.show();
+    wnd.record_stats(true);
+
+    wnd.invalidate();
+    wnd.draw(fb);
+    BOOST_REQUIRE(wnd.stats().drawn == 2);
+    BOOST_REQUIRE(wnd.stats().skipped == 0);
+    BOOST_REQUIRE(wnd.stats().dirty_cells == 10);
+    BOOST_REQUIRE(wnd.stats().widgets.size() == 2);
+    BOOST_REQUIRE(wnd.stats().widgets[0].w == &text1);
+    wnd.record_output(123);
+    BOOST_REQUIRE(wnd.stats().bytes_out == 123);
+
+    wnd.update(&text2);
+    wnd.draw(fb);
+    BOOST_REQUIRE(wnd.stats().drawn == 1);
+    BOOST_REQUIRE(wnd.stats().skipped == 1);
+    BOOST_REQUIRE(wnd.stats().dirty_cells == 5);
+    BOOST_REQUIRE(wnd.stats().widgets[0].w == &text2);
+    BOOST_REQUIRE(wnd.stats().bytes_out == 0);
+    BOOST_REQUIRE(wnd.draw_times().count() == 2);
+
+    wnd.animate(fb, 10);
+    BOOST_REQUIRE(wnd.animate_times().count() == 1);
+
+    wnd.record_stats(false);
+    BOOST_REQUIRE(wnd.draw_times().count() == 0);
+    wnd.draw(fb);
+    BOOST_REQUIRE(wnd.draw_times().count() == 0);
+}
+
+void record_draw(cli::window* wnd, cli::buffer* fb, cli::session_writer* session)
+{
+    session->frame(wnd->draw(*fb), 0);
+}
+
+struct blink_widget : public cli::widget
+{
+    blink_widget() : frames(0) {}
+
+    int height() const { return 1; }
+    int width() const { return 1; }
+    cli::rect draw(cli::buffer&)
+    {
+        return bounds();
+    }
+    cli::rect animate(cli::buffer&, int)
+    {
+        ++frames;
+        return bounds();
+    }
+    int next_frame() const
+    {
+        return 100;
+    }
+    int frames;
+};
+
+void write_event(cli::session_writer& session, int type, int millis, int raw, const cli::rect& rc)
+{
+    cli::session_event e = {};
+    e.type   = type;
+    e.millis = millis;
+    e.raw    = raw;
+    e.vk     = -1;
+    e.rc     = rc;
+    session.write(e);
+}
+
+/*
+ * Synopsis: Verify session recording and replay.
+ *
+ * Expected: The recorded events read back as written and replaying the
+ *           session into a new window produces the same damage as the
+ *           recording. Animations are replayed at the recorded frame times
+ *           and their damage is matched against the key they follow.
+ *           Pasted text is recorded and replayed in one go.
+ */
+void test17()
+{
+    {
+        std::stringstream ss;
+        cli::write_varint(ss, 300);
+        cli::write_svarint(ss, -1);
+        cli::write_svarint(ss, -300);
+        unsigned long long u = 0;
+        int i = 0;
+        BOOST_REQUIRE(cli::read_varint(ss, u) && u == 300);
+        BOOST_REQUIRE(cli::read_svarint(ss, i) && i == -1);
+        BOOST_REQUIRE(cli::read_svarint(ss, i) && i == -300);
+        BOOST_REQUIRE(!cli::read_varint(ss, u));
+    }
+
+    cli::size screen;
+    screen.cols = 20;
+    screen.rows = 5;
+
+    cli::buffer fb;
+    fb.resize(screen.rows, screen.cols);
+
+    // record a session by typing into an input widget.
+    std::stringstream ss;
+    {
+        cli::session_writer session(ss, screen);
+        cli::basic_input<> input;
+        input.width(10);
+        cli::window wnd;
+        wnd.add(&input);
+        wnd.show();
+        wnd.evtdraw = std::bind(record_draw, std::placeholders::_1, &fb, &session);
+        wnd.draw(fb);
+
+        const char* keys = "abc";
+        for (int i=0; i<3; ++i)
+        {
+            session.key(keys[i], -1);
+            wnd.keydown(keys[i], -1);
+        }
+        session.key('\b', cli::VK_ERASE);
+        wnd.keydown('\b', cli::VK_ERASE);
+        BOOST_REQUIRE(input.value() == "ab");
+    }
+
+    // read the events back.
+    {
+        std::stringstream in(ss.str());
+        cli::session_reader session(in);
+        BOOST_REQUIRE(session.screen().cols == 20);
+        BOOST_REQUIRE(session.screen().rows == 5);
+        cli::session_event e;
+        BOOST_REQUIRE(session.next(e));
+        BOOST_REQUIRE(e.type == cli::SESSION_KEY);
+        BOOST_REQUIRE(e.raw == 'a' && e.vk == -1);
+        BOOST_REQUIRE(session.next(e));
+        BOOST_REQUIRE(e.type == cli::SESSION_FRAME);
+        BOOST_REQUIRE(e.rc.left == 0 && e.rc.right == 10);
+        int events = 2;
+        while (session.next(e))
+            ++events;
+        BOOST_REQUIRE(events == 8);
+        BOOST_REQUIRE(e.type == cli::SESSION_FRAME);
+    }
+
+    // replay into a fresh window.
+    {
+        std::stringstream in(ss.str());
+        cli::session_reader session(in);
+        cli::basic_input<> input;
+        input.width(10);
+        cli::window wnd;
+        wnd.add(&input);
+        wnd.show();
+
+        const cli::replay_report report = cli::session_replay(session, wnd, fb);
+        BOOST_REQUIRE(report.keys == 4);
+        BOOST_REQUIRE(report.frames == 4);
+        BOOST_REQUIRE(report.recorded_frames == 4);
+        BOOST_REQUIRE(report.mismatches == 0);
+        BOOST_REQUIRE(report.frame_us.size() == 4);
+        BOOST_REQUIRE(input.value() == "ab");
+        BOOST_REQUIRE(!wnd.evtdraw);
+    }
+
+    // a blinking widget animates every 100ms. the blink recorded
+    // 100ms after the first key belongs to it, the key after 50ms
+    // must not animate and the second blink comes 50ms later.
+    {
+        const cli::rect text  = cli::make_rect(0, 0, 10, 1);
+        const cli::rect blink = cli::make_rect(0, 2, 1, 1);
+        std::stringstream ss;
+        {
+            cli::session_writer session(ss, screen);
+            write_event(session, cli::SESSION_KEY,   0,   'a', cli::rect());
+            write_event(session, cli::SESSION_FRAME, 0,   0,   text);
+            write_event(session, cli::SESSION_FRAME, 100, 0,   blink);
+            write_event(session, cli::SESSION_KEY,   50,  'b', cli::rect());
+            write_event(session, cli::SESSION_FRAME, 0,   0,   text);
+            write_event(session, cli::SESSION_FRAME, 50,  0,   blink);
+        }
+
+        std::stringstream in(ss.str());
+        cli::session_reader session(in);
+        cli::basic_input<> input;
+        input.width(10);
+        blink_widget blinker;
+        blinker.position(0, 2);
+        cli::window wnd;
+        wnd.add(&blinker);
+        wnd.add(&input);
+        wnd.show();
+
+        const cli::replay_report report = cli::session_replay(session, wnd, fb);
+        BOOST_REQUIRE(report.keys == 2);
+        BOOST_REQUIRE(report.recorded_frames == 4);
+        BOOST_REQUIRE(report.frames == 4);
+        BOOST_REQUIRE(report.mismatches == 0);
+        BOOST_REQUIRE(blinker.frames == 2);
+        BOOST_REQUIRE(input.value() == "ab");
+    }
+
+    // pastes are recorded and replayed like keys.
+    {
+        std::stringstream ss;
+        {
+            cli::session_writer session(ss, screen);
+            cli::basic_input<> input;
+            input.width(10);
+            cli::window wnd;
+            wnd.add(&input);
+            wnd.show();
+            wnd.evtdraw = std::bind(record_draw, std::placeholders::_1, &fb, &session);
+            wnd.draw(fb);
+
+            session.key('a', -1);
+            wnd.keydown('a', -1);
+            const std::string text = "xyz";
+            session.paste(text);
+            wnd.paste(text.data(), text.size());
+            BOOST_REQUIRE(input.value() == "axyz");
+        }
+
+        std::stringstream in(ss.str());
+        cli::session_reader session(in);
+        cli::basic_input<> input;
+        input.width(10);
+        cli::window wnd;
+        wnd.add(&input);
+        wnd.show();
+
+        const cli::replay_report report = cli::session_replay(session, wnd, fb);
+        BOOST_REQUIRE(report.keys == 1);
+        BOOST_REQUIRE(report.pastes == 1);
+        BOOST_REQUIRE(report.mismatches == 0);
+        BOOST_REQUIRE(report.frame_us.size() == 2);
+        BOOST_REQUIRE(input.value() == "axyz");
+    }
+
+    std::stringstream bad("XXXX");
+    bool thrown = false;
+    try
+    {
+        cli::session_reader session(bad);
+    }
+    catch (const std::runtime_error&)
+    {
+        thrown = true;
+    }
+    BOOST_REQUIRE(thrown);
+}
+
+bool buffer_equal(const cli::buffer& lhs, const cli::buffer& rhs)
+{
+    if (lhs.rows() != rhs.rows() || lhs.cols() != rhs.cols())
+        return false;
+    for (size_t row=0; row<lhs.rows(); ++row)
+    {
+        for (size_t col=0; col<lhs.cols(); ++col)
+        {
+            if (!(lhs[row][col] == rhs[row][col]))
+                return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Synopsis: Verify the frame dump round trip.
+ *
+ * Expected: Keyframes and deltas decode back into the frames that were 
+ *           written, the dump is much smaller than the raw frames and
+ *           corrupted deltas are rejected.
+ */
+void test18()
+{
+    cli::buffer fb;
+    fb.resize(10, 30);
+    fb.clear();
+
+    cli::basic_list<namedb> list;
+    list.width(30);
+    list.height(10);
+    list.set_focus(true);
+    for (int i=0; i<40; ++i)
+        list.names.push_back(i % 2 ? "odd row" : "even row");
+
+    std::vector<cli::buffer> frames;
+    std::stringstream ss;
+    {
+        cli::frame_writer writer(ss, 10, 30, 4);
+        writer.write(fb);
+        frames.push_back(fb);
+        for (int i=0; i<8; ++i)
+        {
+            list.invalidate(true);
+            const cli::rect rc = list.draw(fb);
+            writer.write(fb, rc);
+            frames.push_back(fb);
+            list.keydown(0, cli::VK_MOVE_DOWN);
+        }
+        // nothing changed.
+        writer.write(fb);
+        frames.push_back(fb);
+        BOOST_REQUIRE(writer.frames() == 10);
+    }
+    // much smaller than the raw frames.
+    BOOST_REQUIRE(ss.str().size() < 10 * 300 * sizeof(cli::cell) / 4);
+
+    cli::frame_reader reader(ss);
+    BOOST_REQUIRE(reader.rows() == 10);
+    BOOST_REQUIRE(reader.cols() == 30);
+
+    cli::buffer out;
+    cli::rect dirty;
+    for (size_t i=0; i<frames.size(); ++i)
+    {
+        BOOST_REQUIRE(reader.next(out, &dirty));
+        BOOST_REQUIRE(buffer_equal(out, frames[i]));
+    }
+    BOOST_REQUIRE(cli::rect_is_empty(dirty));
+    BOOST_REQUIRE(!reader.next(out));
+
+    // a corrupted delta is rejected.
+    std::stringstream bad;
+    {
+        cli::frame_writer writer(bad, 2, 2);
+        cli::buffer small(2, 2);
+        small.clear();
+        writer.write(small);
+    }
+    std::string dump = bad.str();
+    dump += static_cast<char>(cli::FRAME_DELTA);
+    dump += static_cast<char>(100);
+    dump += static_cast<char>(1);
+    std::stringstream in(dump);
+    cli::frame_reader badreader(in);
+    cli::buffer small;
+    BOOST_REQUIRE(badreader.next(small));
+    BOOST_REQUIRE(!badreader.next(small));
+}
+
+/*
+ * Synopsis: Verify UTF-8 decoding, character widths and wide character cells.
+ *
+ * Expected: Code points decode and encode correctly, invalid input decodes
+ *           to the replacement character and double width characters take
+ *           two cells without being split at the edge of the output.
+ */
+void test19()
+{
+    BOOST_REQUIRE(cli::is_ascii("hello world, this is ascii", 26));
+    BOOST_REQUIRE(!cli::is_ascii("hello world, this is n\xc3\xb6t", 25));
+    BOOST_REQUIRE(!cli::is_ascii("\xc3\xb6", 2));
+
+    // a, o umlaut, euro sign, a CJK character, an emoji and an invalid byte.
+    const char utf8[] = "a\xc3\xb6\xe2\x82\xac\xe6\x97\xa5\xf0\x9f\x98\x80\xff";
+    const char* str = utf8;
+    const char* end = utf8 + sizeof(utf8) - 1;
+    BOOST_REQUIRE(cli::utf8_decode(str, end) == 'a');
+    BOOST_REQUIRE(cli::utf8_decode(str, end) == 0xF6);
+    BOOST_REQUIRE(cli::utf8_decode(str, end) == 0x20AC);
+    BOOST_REQUIRE(cli::utf8_decode(str, end) == 0x65E5);
+    BOOST_REQUIRE(cli::utf8_decode(str, end) == 0x1F600);
+    BOOST_REQUIRE(cli::utf8_decode(str, end) == cli::UNICODE_REPLACEMENT);
+    BOOST_REQUIRE(str == end);
+
+    // overlong encoding and a truncated sequence.
+    const char bad[] = "\xc0\xaf\xe6\x97";
+    str = bad;
+    end = bad + 4;
+    BOOST_REQUIRE(cli::utf8_decode(str, end) == cli::UNICODE_REPLACEMENT);
+    BOOST_REQUIRE(str == bad + 1);
+
+    char out[4];
+    BOOST_REQUIRE(cli::utf8_encode(0x65E5, out) == 3);
+    BOOST_REQUIRE(std::memcmp(out, "\xe6\x97\xa5", 3) == 0);
+    BOOST_REQUIRE(cli::utf8_encode(0x1F600, out) == 4);
+    BOOST_REQUIRE(std::memcmp(out, "\xf0\x9f\x98\x80", 4) == 0);
+
+    BOOST_REQUIRE(cli::char_width('a') == 1);
+    BOOST_REQUIRE(cli::char_width(0xF6) == 1);
+    BOOST_REQUIRE(cli::char_width(0x0301) == 0);
+    BOOST_REQUIRE(cli::char_width(0x65E5) == 2);
+    BOOST_REQUIRE(cli::char_width(0xAC00) == 2);
+    BOOST_REQUIRE(cli::char_width(0x1F600) == 2);
+    BOOST_REQUIRE(cli::char_width(0x20AC) == 1);
+    BOOST_REQUIRE(cli::utf8_width(utf8, sizeof(utf8) - 1) == 8);
+
+    cli::buffer fb;
+    fb.resize(1, 10);
+    cli::formatter f(fb);
+
+    // o umlaut, a combining accent and two CJK characters.
+    f.print("x\xc3\xb6" "e\xcc\x81\xe6\x97\xa5\xe6\x9c\xac", 10);
+    BOOST_REQUIRE(fb[0][0].value == 'x');
+    BOOST_REQUIRE(fb[0][1].value == 0xF6);
+    BOOST_REQUIRE(fb[0][2].value == 'e');
+    BOOST_REQUIRE(fb[0][3].value == 0x65E5);
+    BOOST_REQUIRE(fb[0][4].value == cli::CELL_WIDE_TAIL);
+    BOOST_REQUIRE(fb[0][5].value == 0x672C);
+    BOOST_REQUIRE(fb[0][6].value == cli::CELL_WIDE_TAIL);
+    BOOST_REQUIRE(fb[0][7].value == 0);
+
+    // a double width character that doesn't fit is not split.
+    f.move(0, 0);
+    f.print("abcd\xe6\x97\xa5", 5);
+    BOOST_REQUIRE(fb[0][3].value == 'd');
+    BOOST_REQUIRE(fb[0][4].value == 0);
+    BOOST_REQUIRE(fb[0][5].value == 0x672C);
+
+    // ascii output is unchanged.
+    f.move(2, 0);
+    f.print("abc", 2, 4);
+    BOOST_REQUIRE(fb[0][2].value == 'a');
+    BOOST_REQUIRE(fb[0][3].value == 'b');
+    BOOST_REQUIRE(fb[0][4].value == 0);
+    BOOST_REQUIRE(fb[0][5].value == 0);
+    BOOST_REQUIRE(fb[0][6].value == cli::CELL_WIDE_TAIL);
+
+    test_ticker ticker;
+    ticker.set("\xe6\x97\xa5" "ab", 4);
+    cli::buffer row;
+    row.resize(1, 4);
+    ticker.scroll(row, 0, 0);
+    BOOST_REQUIRE(row[0][0].value == 0x65E5);
+    BOOST_REQUIRE(row[0][1].value == cli::CELL_WIDE_TAIL);
+    BOOST_REQUIRE(row[0][2].value == 'a');
+    ticker.scroll(row, 0, 0);
+    BOOST_REQUIRE(row[0][0].value == ' ');
+    BOOST_REQUIRE(row[0][1].value == 'a');
+}
+
+/*
+ * Synopsis: Verify the extended colors and the color pair cache.
+ *
+ * Expected: Colors map to the nearest palette entries and the cache 
+ *           reassigns the least recently used pair when it is full,
+ *           skipping the pairs that cells on the screen still use.
+ */
+void test20()
+{
+    BOOST_REQUIRE(cli::is_color_index(cli::color_index(200)));
+    BOOST_REQUIRE(cli::is_color_rgb(cli::color_rgb(1, 2, 3)));
+    BOOST_REQUIRE(!cli::is_color_rgb(cli::COLOR_EXT_NONE));
+    BOOST_REQUIRE(cli::color_to_xterm256(cli::COLOR_EXT_NONE) == -1);
+    BOOST_REQUIRE(cli::color_to_xterm256(cli::color_index(123)) == 123);
+    BOOST_REQUIRE(cli::color_to_xterm256(cli::color_rgb(255, 0, 0)) == 196);
+    BOOST_REQUIRE(cli::color_to_xterm256(cli::color_rgb(0, 0, 0)) == 16);
+    BOOST_REQUIRE(cli::color_to_xterm256(cli::color_rgb(255, 255, 255)) == 231);
+    BOOST_REQUIRE(cli::color_to_xterm256(cli::color_rgb(128, 128, 128)) == 244);
+    BOOST_REQUIRE(cli::xterm256_to_ansi16(9) == 9);
+    BOOST_REQUIRE(cli::xterm256_to_ansi16(196) == (1 | 8));
+    BOOST_REQUIRE(cli::xterm256_to_ansi16(22) == 2);
+    BOOST_REQUIRE(cli::xterm256_to_ansi16(16) == 0);
+    BOOST_REQUIRE(cli::xterm256_to_ansi16(231) == 15);
+
+    cli::color_pair_cache cache(64, 3);
+    int pair = 0;
+    BOOST_REQUIRE(cache.lookup(1, 2, pair) && pair == 64);
+    BOOST_REQUIRE(cache.lookup(-1, 2, pair) && pair == 65);
+    BOOST_REQUIRE(cache.lookup(3, -1, pair) && pair == 66);
+    BOOST_REQUIRE(!cache.lookup(1, 2, pair) && pair == 64);
+    BOOST_REQUIRE(cache.size() == 3);
+    BOOST_REQUIRE(cache.evictions() == 0);
+    // (-1, 2) is now the least recently used.
+    BOOST_REQUIRE(cache.lookup(4, 4, pair) && pair == 65);
+    BOOST_REQUIRE(cache.evictions() == 1);
+    BOOST_REQUIRE(!cache.lookup(3, -1, pair) && pair == 66);
+    BOOST_REQUIRE(!cache.lookup(1, 2, pair) && pair == 64);
+    BOOST_REQUIRE(cache.lookup(-1, 2, pair) && pair == 65);
+    BOOST_REQUIRE(cache.evictions() == 2);
+    cache.clear();
+    BOOST_REQUIRE(cache.size() == 0);
+    BOOST_REQUIRE(cache.lookup(3, -1, pair) && pair == 64);
+
+    // pairs on the screen are skipped when reassigning.
+    BOOST_REQUIRE(cache.lookup(5, 5, pair) && pair == 65);
+    BOOST_REQUIRE(cache.lookup(6, 6, pair) && pair == 66);
+    cache.retain(64);
+    cache.retain(64);
+    cache.retain(65);
+    cache.retain(7);
+    BOOST_REQUIRE(cache.uses(64) == 2 && cache.uses(7) == 0);
+    BOOST_REQUIRE(cache.lookup(7, 7, pair) && pair == 66);
+    BOOST_REQUIRE(!cache.lookup(3, -1, pair) && pair == 64);
+    BOOST_REQUIRE(!cache.lookup(5, 5, pair) && pair == 65);
+    cache.release(65);
+    BOOST_REQUIRE(cache.uses(65) == 0);
+    // (7, 7) is the least recently used but on the screen now.
+    cache.retain(66);
+    BOOST_REQUIRE(cache.lookup(8, 8, pair) && pair == 65);
+    // every pair is on the screen, the least recently used goes.
+    cache.retain(65);
+    BOOST_REQUIRE(cache.lookup(9, 9, pair) && pair == 66);
+    BOOST_REQUIRE(cache.uses(66) == 1);
+    cache.release_all();
+    BOOST_REQUIRE(cache.uses(64) == 0 && cache.uses(65) == 0);
+
+    cli::cell a = {'a', cli::ATTRIB_NONE, cli::COLOR_NONE, 0, 0};
+    cli::cell b = a;
+    b.bg = cli::color_rgb(10, 20, 30);
+    BOOST_REQUIRE(!(a == b));
+
+    // extended colors survive a frame dump.
+    cli::buffer fb(2, 4);
+    fb.clear();
+    fb[1][2] = b;
+    std::stringstream ss;
+    {
+        cli::frame_writer writer(ss, 2, 4);
+        writer.write(fb);
+        fb[0][0].fg = cli::color_index(42);
+        writer.write(fb);
+    }
+    cli::frame_reader reader(ss);
+    cli::buffer out;
+    BOOST_REQUIRE(reader.next(out));
+    BOOST_REQUIRE(out[1][2] == b);
+    BOOST_REQUIRE(reader.next(out));
+    BOOST_REQUIRE(out[0][0].fg == cli::color_index(42));
+}
+
+// policies written against the string only interfaces.
+class upper_mask
+{
+protected:
+    std::string screen(const std::string& input) const
+    {
+        std::string ret(input);
+        for (size_t i=0; i<ret.size(); ++i)
+            ret[i] = static_cast<char>(::toupper(static_cast<unsigned char>(ret[i])));
+        return ret;
+    }
+};
+
+class string_tabs
+{
+public:
+    std::string last;
+protected:
+    std::string next() { return last; }
+    std::string prev() { return last; }
+    void update(const std::string& input, char)
+    {
+        last = input;
+    }
+};
+
+/*
+ * Synopsis: Verify the gap buffer and the input widget editing on top of it.
+ *
+ * Expected: Inserts and erases anywhere in the buffer keep the text intact
+ *           and the input widget only draws the visible part of the text.
+ *           Policies that only take strings still work.
+ */
+void test21()
+{
+    cli::gap_buffer gb;
+    BOOST_REQUIRE(gb.empty());
+    gb.insert(0, "world", 5);
+    gb.insert(0, "hello", 5);
+    gb.insert(5, ' ');
+    BOOST_REQUIRE(gb.str() == "hello world");
+    BOOST_REQUIRE(gb[6] == 'w');
+    gb.erase(0, 6);
+    BOOST_REQUIRE(gb.str() == "world");
+    gb.insert(5, "!", 1);
+    gb.erase(1, 3);
+    BOOST_REQUIRE(gb.str() == "wd!");
+    char out[3];
+    gb.copy(0, 3, out);
+    BOOST_REQUIRE(std::string(out, 3) == "wd!");
+    gb.assign(std::string(5000, 'x'));
+    BOOST_REQUIRE(gb.size() == 5000);
+    for (int i=0; i<1000; ++i)
+        gb.insert(2500, 'y');
+    BOOST_REQUIRE(gb.size() == 6000);
+    BOOST_REQUIRE(gb[2499] == 'x' && gb[2500] == 'y' && gb[3499] == 'y' && gb[3500] == 'x');
+    gb.clear();
+    BOOST_REQUIRE(gb.empty());
+
+    cli::buffer fb;
+    fb.resize(1, 10);
+
+    // typing a long input only draws the visible window.
+    cli::basic_input<> input;
+    input.width(5);
+    input.set_focus(true);
+    const std::string text = "abcdefghij";
+    for (size_t i=0; i<text.size(); ++i)
+        input.keydown(text[i], -1);
+    BOOST_REQUIRE(input.value() == text);
+    input.draw(fb);
+    BOOST_REQUIRE(row_text(fb, 0, 5) == "fghij");
+
+    input.keydown(0, cli::VK_MOVE_PREV);
+    input.keydown(0, cli::VK_MOVE_PREV);
+    input.keydown(0, cli::VK_ERASE);
+    BOOST_REQUIRE(input.value() == "abcdefgij");
+    input.keydown(0, cli::VK_KILL_CHAR);
+    BOOST_REQUIRE(input.value() == "abcdefgj");
+    input.keydown('X', -1);
+    BOOST_REQUIRE(input.value() == "abcdefgXj");
+    input.keydown(0, cli::VK_KILL_LINE);
+    BOOST_REQUIRE(input.value() == "abcdefgX");
+
+    input.keydown(0, cli::VK_MOVE_HOME);
+    input.draw(fb);
+    BOOST_REQUIRE(row_text(fb, 0, 5) == "abcde");
+
+    cli::password_input pass;
+    pass.width(8);
+    pass.set_focus(true);
+    pass.value("secret");
+    pass.draw(fb);
+    BOOST_REQUIRE(row_text(fb, 0, 8) == "******  ");
+
+    cli::basic_input<upper_mask, cli::alnum, string_tabs> legacy;
+    legacy.width(8);
+    legacy.set_focus(true);
+    legacy.keydown('a', -1);
+    legacy.keydown('b', -1);
+    BOOST_REQUIRE(legacy.last == "ab");
+    legacy.draw(fb);
+    BOOST_REQUIRE(row_text(fb, 0, 8) == "AB      ");
+
+    // the completion policies see the input buffer itself.
+    cli::gap_buffer web;
+    web.assign(std::string("web"));
+    BOOST_REQUIRE(cli::text_starts_with(web, "we"));
+    BOOST_REQUIRE(!cli::text_starts_with(web, "wex"));
+    BOOST_REQUIRE(!cli::text_starts_with(web, "webs"));
+    std::string copy;
+    cli::text_assign(copy, web);
+    BOOST_REQUIRE(copy == "web");
+}
+
+int paste_draws;
+
+void count_paste_draws(cli::window* wnd, cli::buffer* fb)
+{
+    ++paste_draws;
+    wnd->draw(*fb);
+}
+
+/*
+ * Synopsis: Verify pasting text into an input widget.
+ *
+ * Expected: The pasted text is inserted at the caret in one go with
+ *           a single draw, line breaks become spaces and characters 
+ *           rejected by the input mask are dropped.
+ */
+void test22()
+{
+    cli::buffer fb;
+    fb.resize(2, 20);
+
+    cli::basic_input<> input;
+    input.width(10);
+    cli::numeric_input number;
+    number.width(10);
+    number.position(0, 1);
+
+    cli::window wnd;
+    wnd.add(&input);
+    wnd.add(&number);
+    wnd.show();
+    wnd.evtdraw = std::bind(count_paste_draws, std::placeholders::_1, &fb);
+    wnd.draw(fb);
+
+    wnd.keydown('a', -1);
+    wnd.keydown('z', -1);
+    wnd.keydown(0, cli::VK_MOVE_PREV);
+    paste_draws = 0;
+    const std::string text = "{\"key\":\n \"value\"}";
+    BOOST_REQUIRE(wnd.paste(text.data(), text.size()));
+    BOOST_REQUIRE(paste_draws == 1);
+    BOOST_REQUIRE(input.value() == "a{\"key\":  \"value\"}z");
+
+    // the caret is at the end of the pasted text.
+    wnd.keydown('!', -1);
+    BOOST_REQUIRE(input.value() == "a{\"key\":  \"value\"}!z");
+
+    wnd.keydown(0, cli::VK_FOCUS_NEXT);
+    BOOST_REQUIRE(wnd.paste("12ab34", 6));
+    BOOST_REQUIRE(number.value() == "1234");
+    BOOST_REQUIRE(!wnd.paste("abc", 3));
+    BOOST_REQUIRE(!wnd.paste("", 0));
+    BOOST_REQUIRE(number.value() == "1234");
+
+    // widgets that don't take text ignore it.
+    cli::text label;
+    label.settext("label");
+    BOOST_REQUIRE(!label.paste("abc", 3));
+}
+
+struct test_tablist : public cli::prefix_tablist
+{
+    using cli::prefix_tablist::next;
+    using cli::prefix_tablist::prev;
+    using cli::prefix_tablist::update;
+};
+
+/*
+ * Synopsis: Verify the prefix tab completion policy.
+ *
+ * Expected: Typing narrows the candidates to the ones starting with the
+ *           input, tab completion cycles through them in sorted order
+ *           and cycling through a large list doesn't allocate.
+ */
+void test23()
+{
+    cli::prefix_tablist::list hosts;
+    hosts.push_back("web02");
+    hosts.push_back("db01");
+    hosts.push_back("web01");
+    hosts.push_back("web");
+    hosts.push_back("worker");
+    hosts.push_back("web01");
+
+    test_tablist tabs;
+    tabs.setlist(hosts);
+    BOOST_REQUIRE(tabs.size() == 5);
+    BOOST_REQUIRE(tabs.matches() == 5);
+
+    tabs.update("w", 'w');
+    BOOST_REQUIRE(tabs.matches() == 4);
+    tabs.update("we", 'e');
+    BOOST_REQUIRE(tabs.matches() == 3);
+    BOOST_REQUIRE(tabs.next() == "web");
+    BOOST_REQUIRE(tabs.next() == "web01");
+    BOOST_REQUIRE(tabs.next() == "web02");
+    BOOST_REQUIRE(tabs.next() == "web");
+    BOOST_REQUIRE(tabs.prev() == "web02");
+
+    tabs.update("web0", '0');
+    BOOST_REQUIRE(tabs.matches() == 2);
+    BOOST_REQUIRE(tabs.prev() == "web02");
+
+    // erasing starts over from the whole list.
+    tabs.update("d", 0);
+    BOOST_REQUIRE(tabs.matches() == 1);
+    BOOST_REQUIRE(tabs.next() == "db01");
+    tabs.update("x", 'x');
+    BOOST_REQUIRE(tabs.matches() == 0);
+    BOOST_REQUIRE(tabs.next().empty());
+    tabs.update("", 0);
+    BOOST_REQUIRE(tabs.matches() == 5);
+
+    // through the input widget.
+    cli::basic_input<cli::cleartext, cli::alnum, cli::prefix_tablist> input;
+    input.width(20);
+    input.set_focus(true);
+    input.setlist(hosts);
+    input.keydown('w', -1);
+    input.keydown('o', -1);
+    input.keydown(0, cli::VK_TAB_COMPLETE_NEXT);
+    BOOST_REQUIRE(input.value() == "worker");
+
+    cli::prefix_tablist::list names;
+    for (int i=0; i<100000; ++i)
+    {
+        std::stringstream ss;
+        ss << "metric." << i % 100 << "." << i;
+        names.push_back(ss.str());
+    }
+    tabs.setlist(names);
+    BOOST_REQUIRE(tabs.size() == 100000);
+    tabs.update("metric.4", '4');
+    BOOST_REQUIRE(tabs.matches() == 11000);
+    tabs.update("metric.42.", '.');
+    BOOST_REQUIRE(tabs.matches() == 1000);
+    tabs.next();
+    const cli::alloc_stats before = cli::alloc_counters();
+    for (int i=0; i<2000; ++i)
+        BOOST_REQUIRE(tabs.next().compare(0, 10, "metric.42.") == 0);
+    const cli::alloc_stats allocs = cli::alloc_counters() - before;
+    BOOST_REQUIRE(allocs.allocs == 0);
+}
+
+struct test_fuzzy : public cli::fuzzy_tablist
+{
+    using cli::fuzzy_tablist::next;
+    using cli::fuzzy_tablist::prev;
+    using cli::fuzzy_tablist::update;
+};
+
+/*
+ * Synopsis: Verify the fuzzy completion policy.
+ *
+ * Expected: Candidates containing the input as a subsequence match, 
+ *           matches at word boundaries and consecutive matches rank 
+ *           first, only the best matches are kept and the parallel scan
+ *           ranks the same as a single thread.
+ */
+void test24()
+{
+    int score = 0;
+    BOOST_REQUIRE(cli::fuzzy_score("abc", 3, "a_b_c", 5, false, score));
+    BOOST_REQUIRE(!cli::fuzzy_score("abc", 3, "acb", 3, false, score));
+    BOOST_REQUIRE(cli::fuzzy_score("", 0, "anything", 8, false, score) && score == 0);
+
+    int consecutive = 0;
+    int spread = 0;
+    cli::fuzzy_score("cpu", 3, "xcpux", 5, false, consecutive);
+    cli::fuzzy_score("cpu", 3, "xcxpxux", 7, false, spread);
+    BOOST_REQUIRE(consecutive > spread);
+
+    int boundary = 0;
+    int middle = 0;
+    cli::fuzzy_score("l", 1, "system.load", 11, false, boundary);
+    cli::fuzzy_score("l", 1, "system.wall", 11, false, middle);
+    BOOST_REQUIRE(boundary > middle);
+
+    // smart case.
+    BOOST_REQUIRE(cli::fuzzy_score("ab", 2, "xAxB", 4, false, score));
+    BOOST_REQUIRE(!cli::fuzzy_score("Ab", 2, "xaxb", 4, true, score));
+
+    cli::fuzzy_tablist::list metrics;
+    metrics.push_back("disk.read.bytes");
+    metrics.push_back("cpu.user");
+    metrics.push_back("cpu.system");
+    metrics.push_back("net.rx.packets");
+    metrics.push_back("scheduler.cpu.usage");
+
+    test_fuzzy tabs;
+    tabs.setlist(metrics);
+    BOOST_REQUIRE(tabs.matches() == 5);
+    tabs.update("cpu", 'u');
+    BOOST_REQUIRE(tabs.match_count() == 3);
+    BOOST_REQUIRE(tabs.match(0) == "cpu.user");
+    BOOST_REQUIRE(tabs.match(1) == "cpu.system");
+    BOOST_REQUIRE(tabs.match(2) == "scheduler.cpu.usage");
+    BOOST_REQUIRE(tabs.next() == "cpu.user");
+    BOOST_REQUIRE(tabs.next() == "cpu.system");
+    BOOST_REQUIRE(tabs.prev() == "cpu.user");
+    tabs.update("cpus", 's');
+    BOOST_REQUIRE(tabs.match_count() == 3);
+    BOOST_REQUIRE(tabs.match(0) == "cpu.system");
+    tabs.update("rb", 0);
+    BOOST_REQUIRE(tabs.matches() == 1);
+    BOOST_REQUIRE(tabs.match(0) == "disk.read.bytes");
+    tabs.update("zz", 'z');
+    BOOST_REQUIRE(tabs.matches() == 0);
+    BOOST_REQUIRE(tabs.next().empty());
+
+    cli::basic_input<cli::cleartext, cli::alnum, cli::fuzzy_tablist> input;
+    input.width(30);
+    input.set_focus(true);
+    input.setlist(metrics);
+    input.keydown('n', -1);
+    input.keydown('r', -1);
+    input.keydown(0, cli::VK_TAB_COMPLETE_NEXT);
+    BOOST_REQUIRE(input.value() == "net.rx.packets");
+
+    cli::fuzzy_tablist::list names;
+    for (int i=0; i<200000; ++i)
+    {
+        std::stringstream ss;
+        ss << "host" << i % 1000 << ".rack" << i % 37 << ".metric" << i;
+        names.push_back(ss.str());
+    }
+    test_fuzzy serial;
+    serial.set_threads(1);
+    serial.setlist(names);
+    test_fuzzy parallel;
+    parallel.set_threads(4);
+    parallel.set_max_matches(20);
+    parallel.setlist(names);
+
+    const char* keys = "h12r3m";
+    std::string pattern;
+    for (int i=0; keys[i]; ++i)
+    {
+        pattern.push_back(keys[i]);
+        serial.update(pattern, keys[i]);
+        parallel.update(pattern, keys[i]);
+        BOOST_REQUIRE(serial.match_count() == parallel.match_count());
+        BOOST_REQUIRE(serial.matches() == 50 || serial.matches() == serial.match_count());
+        BOOST_REQUIRE(parallel.matches() == std::min(20, parallel.match_count()));
+        for (int m=0; m<parallel.matches(); ++m)
+            BOOST_REQUIRE(serial.match(m) == parallel.match(m));
+    }
+    BOOST_REQUIRE(parallel.match_count() > 0);
+}
+
+struct test_filebrowser : public cli::filebrowser
+{
+    using cli::filebrowser::next;
+    using cli::filebrowser::prev;
+    using cli::filebrowser::update;
+};
+
+// count the distinct completions by cycling through them once.
+int count_completions(test_filebrowser& fb)
+{
+    const std::string& first = fb.next();
+    if (first.empty())
+        return 0;
+    int count = 1;
+    while (&fb.next() != &first)
+        ++count;
+    return count;
+}
+
+// keep changing the directory until told to stop.
+void churn_directory(std::string dir, std::atomic<bool>* stop)
+{
+    const std::string file = dir + "churn";
+    while (!*stop)
+    {
+        std::ofstream(file.c_str());
+        std::remove(file.c_str());
+    }
+}
+
+/*
+ * Synopsis: Verify the asynchronous and cached directory listing
+ *           of the filebrowser completion policy.
+ *
+ * Expected: The listing is read in the background, completions are
+ *           filtered by the mask and the typed prefix, a second browser
+ *           sharing the cache gets the listing without waiting and
+ *           on linux changes to the directory invalidate the listing.
+ *           The least recently used listings and their watches are 
+ *           dropped when the cache is full. A directory that changes
+ *           during every read still gets a listing.
+ */
+void test25()
+{
+    namespace fs = boost::filesystem;
+
+    const fs::path root = fs::temp_directory_path() / fs::unique_path("cli-test-%%%%-%%%%");
+    fs::create_directory(root);
+    fs::create_directory(root / "cherry");
+    std::ofstream((root / "apple").string().c_str());
+    std::ofstream((root / "apricot").string().c_str());
+    std::ofstream((root / "banana").string().c_str());
+
+    const std::string dir = root.string() + "/";
+
+    std::shared_ptr<cli::directory_cache> cache(new cli::directory_cache);
+
+    test_filebrowser fb;
+    fb.set_directory_cache(cache);
+    fb.set_file_mask(cli::filebrowser::files);
+    fb.update(dir, '/');
+    fb.listing_wait();
+    BOOST_REQUIRE(!fb.listing_pending());
+    BOOST_REQUIRE(count_completions(fb) == 3);
+
+    fb.update(dir + "ap", 'p');
+    BOOST_REQUIRE(fb.next() == dir + "apricot");
+    BOOST_REQUIRE(fb.next() == dir + "apple");
+    BOOST_REQUIRE(count_completions(fb) == 2);
+
+    BOOST_REQUIRE(cache->is_cached(dir));
+
+    test_filebrowser other;
+    other.set_directory_cache(cache);
+    other.set_file_mask(cli::filebrowser::files | cli::filebrowser::folders);
+    other.update(dir, '/');
+    BOOST_REQUIRE(!other.listing_pending());
+    BOOST_REQUIRE(count_completions(other) == 4);
+
+    // a directory that doesn't exist has no completions.
+    other.update(dir + "nope/", '/');
+    other.listing_wait();
+    BOOST_REQUIRE(count_completions(other) == 0);
+
+#if defined(__linux__)
+    std::ofstream((root / "avocado").string().c_str());
+    BOOST_REQUIRE(!cache->is_cached(dir));
+    other.update(dir, '/');
+    other.listing_wait();
+    BOOST_REQUIRE(count_completions(other) == 5);
+    BOOST_REQUIRE(cache->is_cached(dir));
+    BOOST_REQUIRE(cache->watches() == 1);
+#endif
+
+    const std::string cherry = dir + "cherry/";
+    cache->set_capacity(2);
+    cache->wait(cherry);
+    cache->wait(dir);
+    BOOST_REQUIRE(cache->size() == 2);
+    cache->wait(dir + "..");
+    BOOST_REQUIRE(cache->size() == 2);
+    BOOST_REQUIRE(!cache->is_cached(cherry));
+    BOOST_REQUIRE(cache->is_cached(dir));
+#if defined(__linux__)
+    BOOST_REQUIRE(cache->watches() == 2);
+#endif
+    cache->clear();
+    BOOST_REQUIRE(cache->size() == 0);
+#if defined(__linux__)
+    BOOST_REQUIRE(cache->watches() == 0);
+#endif
+
+    // a large directory so that it changes during every read.
+    const fs::path busy = root / "busy";
+    fs::create_directory(busy);
+    for (int i=0; i<2000; ++i)
+        std::ofstream((busy / std::to_string(i)).string().c_str());
+    std::atomic<bool> stop(false);
+    std::thread churn(churn_directory, busy.string() + "/", &stop);
+    BOOST_REQUIRE(cache->wait(busy.string() + "/")->size() >= 2000);
+    stop = true;
+    churn.join();
+
+    fs::remove_all(root);
+}
+
+/*
+ * Synopsis: Verify the prefix filtering of the filebrowser completions.
+ *
+ * Expected: Typing narrows the completions to the paths starting with the
+ *           input, erasing widens them again and neither filtering nor
+ *           cycling through the completions allocates.
+ */
+void test26()
+{
+    namespace fs = boost::filesystem;
+
+    const fs::path root = fs::temp_directory_path() / fs::unique_path("cli-test-%%%%-%%%%");
+    fs::create_directory(root);
+    for (int i=0; i<2000; ++i)
+    {
+        std::stringstream ss;
+        ss << "log." << i % 20 << "." << i;
+        std::ofstream((root / ss.str()).string().c_str());
+    }
+    const std::string dir = root.string() + "/";
+
+    test_filebrowser fb;
+    fb.set_file_mask(cli::filebrowser::files);
+    fb.update(dir, '/');
+    fb.listing_wait();
+    BOOST_REQUIRE(count_completions(fb) == 2000);
+
+    const std::string l1   = dir + "log.1";
+    const std::string l12  = dir + "log.12";
+    const std::string l12d = dir + "log.12.";
+    const std::string l3   = dir + "log.3";
+    const std::string none = dir + "log.3x";
+
+    // let the filter strings grow to their final capacity.
+    fb.update(l12d, 0);
+    fb.update(dir, 0);
+
+    const cli::alloc_stats before = cli::alloc_counters();
+    fb.update(l1, '1');
+    BOOST_REQUIRE(count_completions(fb) == 1100);
+    fb.update(l12, '2');
+    BOOST_REQUIRE(count_completions(fb) == 100);
+    fb.update(l12d, '.');
+    BOOST_REQUIRE(count_completions(fb) == 100);
+    BOOST_REQUIRE(fb.next().compare(0, l12d.size(), l12d) == 0);
+    BOOST_REQUIRE(fb.prev().compare(0, l12d.size(), l12d) == 0);
+    fb.update(l3, 0);
+    BOOST_REQUIRE(count_completions(fb) == 100);
+    fb.update(none, 'x');
+    BOOST_REQUIRE(count_completions(fb) == 0);
+    BOOST_REQUIRE(fb.next().empty());
+    fb.update(dir, 0);
+    BOOST_REQUIRE(count_completions(fb) == 2000);
+    const cli::alloc_stats allocs = cli::alloc_counters() - before;
+    BOOST_REQUIRE(allocs.allocs == 0);
+
+    fs::remove_all(root);
+}
+
+void menu_pick(int id, int* out)
+{
+    *out = id;
+}
+
+/*
+ * Synopsis: Verify scrolling and accelerator keys of long submenus.
+ *
+ * Expected: Only as many items as allowed by the max rows or the screen
+ *           height are drawn, the view scrolls to keep the selected item
+ *           visible and an accelerator key selects its item and closes
+ *           the menu.
+ */
+void test27()
+{
+    cli::buffer fb;
+    fb.resize(20, 40);
+
+    cli::menulist list(2);
+    list[0].text = "Recent";
+    for (int i=0; i<300; ++i)
+    {
+        std::stringstream ss;
+        ss << "file" << i;
+        list[0].items.push_back(cli::make_menu_item(ss.str(), i));
+    }
+    list[1].text = "Edit";
+    list[1].items.push_back(cli::make_menu_item("Cut", 1000, false, 't'));
+    list[1].items.push_back(cli::make_menu_item("Copy", 1001, false, 'c'));
+    list[1].items.push_back(cli::make_menu_item("-", 0, true, 'x'));
+
+    int picked = -1;
+    cli::menu m;
+    m.setmenu(list);
+    m.position(0, 0);
+    m.evtmenu = std::bind(menu_pick, std::placeholders::_1, &picked);
+    BOOST_REQUIRE(m.width() == (int)strlen("Recent") + (int)strlen("Edit") + 1);
+
+    // the screen height limits the drop down.
+    m.open(0);
+    cli::rect r = m.draw(fb);
+    BOOST_REQUIRE(r.bottom == 20);
+    BOOST_REQUIRE(row_text(fb, 1, 6) == "file0 ");
+    BOOST_REQUIRE(row_text(fb, 19, 6) == "file18");
+
+    m.set_max_rows(10);
+    r = m.draw(fb);
+    BOOST_REQUIRE(r.bottom == 11);
+
+    // moving past the last visible item scrolls by one.
+    for (int i=0; i<10; ++i)
+        m.keydown(0, cli::VK_MOVE_DOWN);
+    m.draw(fb);
+    BOOST_REQUIRE(row_text(fb, 1, 6) == "file1 ");
+    BOOST_REQUIRE(row_text(fb, 10, 6) == "file10");
+
+    m.keydown(0, cli::VK_MOVE_END);
+    m.draw(fb);
+    BOOST_REQUIRE(row_text(fb, 1, 7) == "file290");
+    BOOST_REQUIRE(row_text(fb, 10, 7) == "file299");
+
+    m.keydown(0, cli::VK_MOVE_UP_PAGE);
+    m.draw(fb);
+    BOOST_REQUIRE(row_text(fb, 1, 7) == "file289");
+
+    // items of other submenus are not accelerators.
+    BOOST_REQUIRE(!m.keydown('t', -1));
+    m.keydown(0, cli::VK_ACTION_ENTER);
+    BOOST_REQUIRE(picked == 289);
+    r = m.erase();
+    BOOST_REQUIRE(r.top == 1 && r.bottom == 11);
+    BOOST_REQUIRE(r.right == (int)strlen("file299"));
+
+    m.open(1);
+    m.draw(fb);
+    BOOST_REQUIRE(!m.keydown('x', -1));
+    BOOST_REQUIRE(m.keydown('C', -1));
+    BOOST_REQUIRE(picked == 1001);
+    BOOST_REQUIRE(!m.is_open());
+    BOOST_REQUIRE(!m.keydown('t', -1));
+}
+
+// fills its area with a character and counts the draws.
+struct fill_widget : public cli::widget
+{
+    fill_widget(int w, int h, char c) : w_(w), h_(h), c_(c), draws(0) {}
+
+    int width() const  { return w_; }
+    int height() const { return h_; }
+    cli::rect draw(cli::buffer& fb)
+    {
+        for (int y=ypos_; y<ypos_ + h_; ++y)
+            for (int x=xpos_; x<xpos_ + w_; ++x)
+                fb[y][x].value = c_;
+        ++draws;
+        return bounds();
+    }
+    int w_, h_;
+    char c_;
+    int draws;
+};
+
+void clear_area(cli::window*, cli::rect rc, cli::buffer* fb)
+{
+    for (int y=rc.top; y<rc.bottom; ++y)
+        for (int x=rc.left; x<rc.right; ++x)
+            (*fb)[y][x].value = ' ';
+}
+
+/*
+ * Synopsis: Verify that a closed menu puts back the cells underneath it.
+ *
+ * Expected: Closing the menu restores the covered cells without redrawing
+ *           the widget underneath. If the widget drew under the open menu
+ *           the area is erased and the widget redrawn instead. Without an
+ *           erase handler the menu still saves the cells again next time.
+ */
+void test28()
+{
+    cli::buffer fb;
+    fb.resize(10, 20);
+
+    cli::menulist list(1);
+    list[0].text = "File";
+    list[0].items.push_back(cli::make_menu_item("Open", 1));
+    list[0].items.push_back(cli::make_menu_item("Close", 2));
+
+    cli::menu m;
+    m.setmenu(list);
+    m.position(0, 0);
+
+    fill_widget under(20, 9, 'x');
+    under.position(0, 1);
+
+    cli::window wnd;
+    wnd.add(&under);
+    wnd.add(&m);
+    wnd.evterase = std::bind(clear_area, std::placeholders::_1, std::placeholders::_2, &fb);
+    wnd.show();
+    wnd.draw(fb);
+    BOOST_REQUIRE(under.draws == 1);
+
+    wnd.keydown(0, cli::VK_OPEN_MENU);
+    wnd.draw(fb);
+    BOOST_REQUIRE(row_text(fb, 2, 6) == "Closex");
+    BOOST_REQUIRE(under.draws == 1);
+
+    wnd.keydown(0, cli::VK_KILL_WINDOW);
+    BOOST_REQUIRE(!m.is_open());
+    cli::rect rc = wnd.draw(fb);
+    BOOST_REQUIRE(under.draws == 1);
+    BOOST_REQUIRE(row_text(fb, 1, 6) == "xxxxxx");
+    BOOST_REQUIRE(row_text(fb, 2, 6) == "xxxxxx");
+    BOOST_REQUIRE(rc.top == 0 && rc.bottom == 3 && rc.right >= 5);
+
+    // drawing under the open menu falls back to erasing.
+    wnd.keydown(0, cli::VK_OPEN_MENU);
+    wnd.draw(fb);
+    under.c_ = 'y';
+    wnd.update(&under);
+    wnd.draw(fb);
+    BOOST_REQUIRE(under.draws == 2);
+    BOOST_REQUIRE(row_text(fb, 1, 5) == "Open ");
+
+    wnd.keydown(0, cli::VK_KILL_WINDOW);
+    wnd.draw(fb);
+    BOOST_REQUIRE(under.draws == 3);
+    BOOST_REQUIRE(row_text(fb, 1, 6) == "yyyyyy");
+
+    // the menu saves the cells again the next time it opens.
+    wnd.keydown(0, cli::VK_OPEN_MENU);
+    wnd.draw(fb);
+    wnd.keydown(0, cli::VK_KILL_WINDOW);
+    wnd.draw(fb);
+    BOOST_REQUIRE(under.draws == 3);
+    BOOST_REQUIRE(row_text(fb, 2, 6) == "yyyyyy");
+
+    // without an erase handler the drawn over cells are left as is.
+    wnd.evterase = nullptr;
+    wnd.keydown(0, cli::VK_OPEN_MENU);
+    wnd.draw(fb);
+    under.c_ = 'z';
+    wnd.update(&under);
+    wnd.draw(fb);
+    BOOST_REQUIRE(under.draws == 4);
+    wnd.keydown(0, cli::VK_KILL_WINDOW);
+    wnd.draw(fb);
+    BOOST_REQUIRE(row_text(fb, 2, 6) == "Closez");
+    wnd.update(&under);
+    wnd.draw(fb);
+    BOOST_REQUIRE(under.draws == 5);
+
+    // the next drop down saves the cells again and nothing is
+    // restored over it while it is open.
+    wnd.keydown(0, cli::VK_OPEN_MENU);
+    wnd.draw(fb);
+    wnd.draw(fb);
+    BOOST_REQUIRE(row_text(fb, 1, 5) == "Open ");
+    wnd.keydown(0, cli::VK_KILL_WINDOW);
+    wnd.draw(fb);
+    BOOST_REQUIRE(under.draws == 5);
+    BOOST_REQUIRE(row_text(fb, 1, 6) == "zzzzzz");
+    BOOST_REQUIRE(row_text(fb, 2, 6) == "zzzzzz");
+
+    // a drop down clipped by the right edge keeps its saved cells
+    // while the selection moves.
+    cli::buffer narrow;
+    narrow.resize(10, 3);
+    fill_widget small(3, 9, 'w');
+    small.position(0, 1);
+
+    cli::window edge;
+    edge.add(&small);
+    edge.add(&m);
+    edge.evterase = std::bind(clear_area, std::placeholders::_1, std::placeholders::_2, &narrow);
+    edge.show();
+    edge.draw(narrow);
+    BOOST_REQUIRE(small.draws == 1);
+
+    edge.keydown(0, cli::VK_OPEN_MENU);
+    edge.draw(narrow);
+    edge.keydown(0, cli::VK_MOVE_DOWN);
+    edge.draw(narrow);
+    BOOST_REQUIRE(row_text(narrow, 2, 3) == "Clo");
+    edge.keydown(0, cli::VK_KILL_WINDOW);
+    edge.draw(narrow);
+    BOOST_REQUIRE(small.draws == 1);
+    BOOST_REQUIRE(row_text(narrow, 1, 3) == "www");
+    BOOST_REQUIRE(row_text(narrow, 2, 3) == "www");
+}
+
+// fills its area with the next character on every frame.
+struct cycle_widget : public fill_widget
+{
+    cycle_widget(int w, int h, char c) : fill_widget(w, h, c) {}
+
+    cli::rect animate(cli::buffer& fb, int)
+    {
+        ++c_;
+        --draws;
+        return draw(fb);
+    }
+    int next_frame() const
+    {
+        return 100;
+    }
+};
+
+/*
+ * Synopsis: Verify the retained mode compositing of the window.
+ *
+ * Expected: Widgets are drawn into their own surfaces only when invalid.
+ *           Overlapping widgets, erased areas and areas under a closed
+ *           menu are composited from the surfaces in z order without
+ *           redrawing the widgets.
+ */
+void test29()
+{
+    cli::buffer fb;
+    fb.resize(10, 20);
+    fb.clear();
+
+    cli::menulist list(1);
+    list[0].text = "File";
+    list[0].items.push_back(cli::make_menu_item("Open", 1));
+
+    cli::menu m;
+    m.setmenu(list);
+    m.position(0, 0);
+
+    fill_widget back(10, 5, 'a');
+    back.position(0, 1);
+    cycle_widget front(6, 2, 'k');
+    front.position(4, 3);
+
+    cli::window wnd;
+    wnd.add(&back);
+    wnd.add(&front);
+    wnd.add(&m);
+    wnd.evterase = std::bind(clear_area, std::placeholders::_1, std::placeholders::_2, &fb);
+    wnd.retained(true);
+    wnd.show();
+    wnd.draw(fb);
+    BOOST_REQUIRE(back.draws == 1 && front.draws == 1);
+    BOOST_REQUIRE(row_text(fb, 0, 4) == "File");
+    BOOST_REQUIRE(row_text(fb, 3, 12) == "aaaakkkkkk  ");
+
+    // redrawing the widget below doesn't draw over the one on top.
+    back.c_ = 'b';
+    wnd.update(&back);
+    wnd.draw(fb);
+    BOOST_REQUIRE(back.draws == 2 && front.draws == 1);
+    BOOST_REQUIRE(row_text(fb, 3, 12) == "bbbbkkkkkk  ");
+    BOOST_REQUIRE(row_text(fb, 1, 12) == "bbbbbbbbbb  ");
+
+    // animation goes into the surface and is composited.
+    cli::rect rc = wnd.animate(fb, 100);
+    BOOST_REQUIRE(row_text(fb, 3, 12) == "bbbbllllll  ");
+    BOOST_REQUIRE(rc.left == 4 && rc.top == 3 && rc.right == 10 && rc.bottom == 5);
+
+    // an erased area is filled from the surfaces.
+    wnd.rem(&front);
+    wnd.draw(fb);
+    BOOST_REQUIRE(back.draws == 2);
+    BOOST_REQUIRE(row_text(fb, 3, 12) == "bbbbbbbbbb  ");
+
+    // the menu is drawn over the surfaces and closing it
+    // composites the area again even after a redraw under it.
+    wnd.keydown(0, cli::VK_OPEN_MENU);
+    wnd.draw(fb);
+    back.c_ = 'c';
+    wnd.update(&back);
+    wnd.draw(fb);
+    BOOST_REQUIRE(back.draws == 3);
+    BOOST_REQUIRE(row_text(fb, 1, 6) == "Opencc");
+    wnd.keydown(0, cli::VK_KILL_WINDOW);
+    wnd.draw(fb);
+    BOOST_REQUIRE(back.draws == 3);
+    BOOST_REQUIRE(row_text(fb, 1, 6) == "cccccc");
+    BOOST_REQUIRE(row_text(fb, 0, 4) == "File");
+}
+
+void draw_stack(cli::window*, cli::window_stack* stack, cli::buffer* fb)
+{
+    stack->draw(*fb);
+}
+
+/*
+ * Synopsis: Verify that popping a modal window restores the frame of the
+ *           window underneath.
+ *
+ * Expected: The window underneath isn't redrawn unless it was updated
+ *           while covered. If the frame buffer was resized it is cleared
+ *           and the window is drawn once.
+ */
+void test30()
+{
+    cli::buffer fb;
+    fb.resize(10, 20);
+    fb.clear();
+
+    fill_widget back(20, 10, 'a');
+    cli::window base;
+    base.add(&back);
+    base.show();
+
+    fill_widget box(10, 3, 'd');
+    box.position(5, 3);
+    cli::window dialog;
+    dialog.add(&box);
+    dialog.show();
+
+    cli::window_stack stack;
+    BOOST_REQUIRE(stack.empty() && stack.top() == NULL);
+    stack.push(&base, fb);
+    stack.draw(fb);
+    BOOST_REQUIRE(back.draws == 1);
+
+    stack.push(&dialog, fb);
+    BOOST_REQUIRE(stack.size() == 2 && stack.top() == &dialog);
+    stack.draw(fb);
+    BOOST_REQUIRE(row_text(fb, 4, 16) == "aaaaadddddddddda");
+
+    cli::rect rc = stack.pop(fb);
+    BOOST_REQUIRE(stack.top() == &base);
+    BOOST_REQUIRE(rc.left == 0 && rc.top == 0 && rc.right == 20 && rc.bottom == 10);
+    BOOST_REQUIRE(row_text(fb, 4, 16) == "aaaaaaaaaaaaaaaa");
+    BOOST_REQUIRE(back.draws == 1);
+
+    // updated while covered.
+    stack.push(&dialog, fb);
+    dialog.invalidate();
+    stack.draw(fb);
+    back.c_ = 'b';
+    base.update(&back);
+    stack.pop(fb);
+    BOOST_REQUIRE(back.draws == 2);
+    BOOST_REQUIRE(row_text(fb, 4, 4) == "bbbb");
+
+    // resized while covered. the window is drawn once into a cleared frame.
+    base.evtdraw = std::bind(draw_stack, std::placeholders::_1, &stack, &fb);
+    stack.push(&dialog, fb);
+    fb.resize(12, 24);
+    fb[11][0].value = 'x';
+    rc = stack.pop(fb);
+    BOOST_REQUIRE(back.draws == 3);
+    BOOST_REQUIRE(rc.left == 0 && rc.top == 0 && rc.right == 24 && rc.bottom == 12);
+    BOOST_REQUIRE(row_text(fb, 4, 24) == "bbbbbbbbbbbbbbbbbbbb    ");
+    BOOST_REQUIRE(row_text(fb, 11, 4) == "    ");
+}
 
 int test_main(int, char* [])
 {
@@ -776,6 +3105,30 @@ int test_main(int, char* [])
     test4();
     test5();
     test6();
+    test7();
+    test8();
+    test9();
+    test10();
+    test11();
+    test12();
+    test13();
+    test14();
+    test15();
+    test16();
+    test17();
+    test18();
+    test19();
+    test20();
+    test21();
+    test22();
+    test23();
+    test24();
+    test25();
+    test26();
+    test27();
+    test28();
+    test29();
+    test30();
 
     return 0;
 }